@@ -33,6 +33,7 @@ public:
     DEVICE_NOT_READY,
     POLL_ERROR,
     TIMEOUT,
+    QUEUE_FULL,
     GENERAL_ERROR
   };
 
@@ -82,6 +83,10 @@ protected:
 
   void registerChildDevice(Device *device);
 
+  // Runs once the device has been loaded into engine, and with nullptr once
+  // it has been taken out of one
+  virtual void engineChanged(ENGINE_PTR engine);
+
   void logDebug(const std::string &calling_class,
                 const std::string &message) const;
   void logInfo(const std::string &calling_class,
@@ -1,13 +1,18 @@
 #ifndef ENGINE
 #define ENGINE
 
+#include "taskqueue.h"
+#include "timerwheel.h"
 #include "transport-cpp.h"
 
+#include <atomic>
 #include <chrono>
-#include <map>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <unordered_set>
 #include <vector>
 
 namespace Context {
@@ -15,38 +20,101 @@ class Device;
 
 class TRANSPORT_CPP_EXPORT Engine {
   friend class Device;
+  friend class WheelTimer;
 
   using POLL_STRUCT = pollfd;
   using POLL_LIST = std::vector<POLL_STRUCT>;
+  using EPOLL_LIST = std::vector<epoll_event>;
   using DEVICE_HANDLE = std::optional<DEVICE_HANDLE_>;
-  using POLL_MAP = std::map<DEVICE_HANDLE_, Device *>;
   using ERROR_STRING = std::string;
-  using DEVICE_LIST = std::vector<Device *>;
+  using DEVICE_LIST = std::unordered_set<Device *>;
   using LOGGER = std::shared_ptr<Transport::Logger>;
+  using TASK = TaskQueue::TASK;
+  using DEVICE_OBSERVER = std::function<void(const Device *)>;
 
 public:
   enum class ERROR_CODE {
     NO_ERROR,
     DEVICE_ALREADY_REGISTERED,
     DEVICE_DOES_NOT_EXIST,
-    INVALID_ARGUMENT
+    INVALID_ARGUMENT,
+    BACKEND_ERROR
   };
 
+  // AUTO selects epoll where the kernel provides it and falls back to poll
+  enum class Backend { AUTO, POLL, EPOLL };
+
   struct ERROR {
     ERROR_CODE code;
     ERROR_STRING description;
   };
 
+  struct Stats {
+    // backend waits performed
+    uint64_t waits = 0;
+    // waits that returned with at least one ready handle
+    uint64_t wakeups = 0;
+    // waits that ran out their timeout with nothing ready
+    uint64_t timeouts = 0;
+    // waits without a timeout that returned with nothing ready
+    uint64_t spurious_wakeups = 0;
+    uint64_t tasks_run = 0;
+    // spin phases entered, zero timeout backend polls made while spinning
+    // and phases that found events before the budget ran out
+    uint64_t spin_loops = 0;
+    uint64_t spin_polls = 0;
+    uint64_t spin_hits = 0;
+  };
+
 private:
+  // Indexed by handle. Ties a handle to its owning device, its position in
+  // mPollDevices and the events currently requested for it
+  struct DeviceSlot {
+    Device *device = nullptr;
+    size_t poll_index = 0;
+    short events = 0;
+    uint32_t generation = 0;
+  };
+
+  using DEVICE_TABLE = std::vector<DeviceSlot>;
+
+  // A handle reported by the backend, with the generation its slot had when
+  // the wait returned
+  struct ReadyDevice {
+    POLL_STRUCT fd;
+    uint32_t generation;
+  };
+
+  using READY_LIST = std::vector<ReadyDevice>;
+
+  class Waker;
+
   ERROR mLastError = {ERROR_CODE::NO_ERROR, ""};
   POLL_LIST mPollDevices;
-  POLL_MAP mDeviceMapping;
+  DEVICE_TABLE mDeviceTable;
   DEVICE_LIST mDeviceList;
+  std::atomic<size_t> mDeviceCount{0};
   LOGGER mLogger = Transport::Logger::DefaultLogger;
+  DEVICE_OBSERVER mDeregistrationObserver;
+
+  Backend mBackend = Backend::POLL;
+  DEVICE_HANDLE mEpollHandle;
+  EPOLL_LIST mEpollEvents;
+  READY_LIST mReadyDevices;
+
+  std::unique_ptr<Waker> mWaker;
+  TaskQueue mTasks;
+  std::atomic<bool> mWakePending{false};
+  std::atomic<bool> mStopRequested{false};
+
+  Stats mStats;
+  TimerWheel mTimerWheel;
+  std::chrono::microseconds mSpinBudget{0};
 
 public:
   ~Engine();
   Engine();
+  explicit Engine(Backend backend);
 
   [[nodiscard]] RETURN_CODE
   registerDevice(std::shared_ptr<Context::Device> device) noexcept;
@@ -58,13 +126,42 @@ public:
 
   void setLogger(const LOGGER &logger) noexcept;
 
+  // Runs on the engine's thread whenever a device leaves the engine,
+  // including when it is destroyed while registered
+  void setDeregistrationObserver(const DEVICE_OBSERVER &observer);
+
   [[nodiscard]] ERROR getLastError() const noexcept;
+  [[nodiscard]] Backend getBackend() const noexcept;
+  // Safe to read from any thread
+  [[nodiscard]] size_t registeredDeviceCount() const noexcept;
+
+  // Thread safe. Queues task to run on the thread driving this engine, waking
+  // it if it is blocked in an await
+  [[nodiscard]] RETURN_CODE post(TASK task);
+  // Runs the tasks posted so far on the calling thread, which must be the
+  // one driving this engine, or any while none is
+  void runPostedTasks();
+  // Thread safe. Interrupts an await blocked on this engine
+  void wake() noexcept;
+  // Thread safe. Makes awaitFor/awaitForever return once the current
+  // iteration is done. If neither is running the next one returns at once
+  void stop() noexcept;
+
+  // Before blocking, poll the backend without a timeout for up to budget.
+  // Trades a core for latency and only pays off when the engine's thread has
+  // a core to itself. Zero (the default) disables spinning
+  void setSpinBudget(const std::chrono::microseconds &budget) noexcept;
+  [[nodiscard]] std::chrono::microseconds getSpinBudget() const noexcept;
+
+  // Only consistent when read from the engine's thread, e.g. through post()
+  [[nodiscard]] Stats getStats() const noexcept;
+  void resetStats() noexcept;
 
   // Awaiters
   void awaitOnce(
       const std::optional<std::chrono::milliseconds> &optional_duration = {});
   void awaitFor(const std::chrono::milliseconds &duration);
-  [[noreturn]] void awaitForever();
+  void awaitForever();
 
 private:
   RETURN_CODE registerDevice(Context::Device *device);
@@ -78,10 +175,26 @@ private:
 
   RETURN_CODE deRegisterHandle(DEVICE_HANDLE handle);
 
-  POLL_LIST::iterator findHandleInList(DEVICE_HANDLE handle);
+  DeviceSlot *findSlot(const DEVICE_HANDLE &handle) noexcept;
+  static void releaseSlot(DeviceSlot &slot) noexcept;
 
   void setError(ERROR_CODE code, const ERROR_STRING &description);
   bool awaitOnceUpto(int ms);
+  bool backendWait(int ms);
+  bool spinWait(int &ms);
+
+  // backends
+  Backend initialiseBackend(Backend backend);
+  bool initialiseEpoll();
+  bool pollReady(int ms);
+  bool epollReady(int ms);
+  void backendAdd(const POLL_STRUCT &fd);
+  void backendModify(const POLL_STRUCT &fd);
+  void backendRemove(DEVICE_HANDLE_ handle);
+  void addReady(const POLL_STRUCT &fd);
+  void dispatchReady();
+
+  void initialiseWaker();
 
   // loggers
   void logDebug(const std::string &calling_class,
@@ -97,6 +210,7 @@ private:
 
   void requestRead(const DEVICE_HANDLE &handle);
   void requestWrite(const DEVICE_HANDLE &handle);
+  void requestEvents(const DEVICE_HANDLE &handle, short events);
 };
 } // namespace Context
 
@@ -0,0 +1,104 @@
+#ifndef ENGINEPOOL_H
+#define ENGINEPOOL_H
+
+#include "engine.h"
+#include "iodevice.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Context {
+
+// Runs one Engine per thread. Devices are placed onto an engine and from then
+// on are only touched by that engine's thread; other threads hand work over
+// with post()
+class TRANSPORT_CPP_EXPORT EnginePool {
+  using TASK = std::function<void()>;
+  using LOGGER = std::shared_ptr<Transport::Logger>;
+  using IODATA = Devices::IO::IODevice::IODATA;
+
+public:
+  enum class Placement { ROUND_ROBIN, LEAST_LOADED };
+
+private:
+  struct Worker {
+    std::unique_ptr<Engine> engine;
+    std::thread thread;
+    std::atomic<size_t> pending{0};
+  };
+
+  using WORKER_LIST = std::vector<std::unique_ptr<Worker>>;
+  using PLACEMENT_MAP = std::unordered_map<const Device *, size_t>;
+  using DEVICE_SET = std::unordered_set<const Device *>;
+
+  WORKER_LIST mWorkers;
+  PLACEMENT_MAP mPlacements;
+  DEVICE_SET mMoving;
+  std::mutex mPlacementLock;
+  std::atomic<size_t> mNextWorker{0};
+  bool mPinThreads;
+  bool mStarted = false;
+  LOGGER mLogger = Transport::Logger::DefaultLogger;
+
+public:
+  explicit EnginePool(size_t thread_count = std::thread::hardware_concurrency(),
+                      Engine::Backend backend = Engine::Backend::AUTO,
+                      bool pin_threads = true);
+  ~EnginePool();
+
+  EnginePool(const EnginePool &) = delete;
+  EnginePool &operator=(const EnginePool &) = delete;
+
+  void start();
+  void stop();
+
+  void setLogger(const LOGGER &logger) noexcept;
+
+  [[nodiscard]] size_t size() const noexcept;
+  [[nodiscard]] bool isRunning() const noexcept;
+
+  // Only safe to use from the engine's own thread, or before start()
+  [[nodiscard]] Engine &engine(size_t index);
+
+  [[nodiscard]] size_t selectEngine(Placement placement) noexcept;
+
+  // The device must outlive its registration. Registration happens
+  // asynchronously on the chosen engine's thread. A device placed on another
+  // engine of the pool is first taken off it on that engine's thread, and is
+  // refused further placements until it has arrived. The placement is dropped
+  // once the device leaves its engine or is destroyed
+  [[nodiscard]] RETURN_CODE
+  registerDevice(Device &device, Placement placement = Placement::ROUND_ROBIN);
+  [[nodiscard]] RETURN_CODE registerDevice(Device &device, size_t index);
+
+  // Thread safe. Runs task on the thread of the given engine
+  [[nodiscard]] RETURN_CODE post(size_t index, TASK task);
+  // Thread safe. Runs task on the thread of the engine the device was placed
+  // on through registerDevice
+  [[nodiscard]] RETURN_CODE post(const Device &device, TASK task);
+
+  // Thread safe asyncSend to a device owned by any engine in the pool
+  [[nodiscard]] RETURN_CODE asyncSend(Devices::IO::IODevice &device,
+                                      IODATA data);
+
+private:
+  void run(Engine &engine, size_t index);
+  // Lets a device whose move has ended be placed again
+  void finishMove(const Device *device);
+  // Drops the device's placement if it is still on engine index
+  void forgetPlacement(const Device *device, size_t index);
+  void pinThread(size_t index);
+
+  void logWarn(const std::string &calling_class,
+               const std::string &message) const;
+  void logError(const std::string &calling_class,
+                const std::string &message) const;
+};
+
+} // namespace Context
+
+#endif // ENGINEPOOL_H
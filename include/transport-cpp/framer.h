@@ -0,0 +1,95 @@
+#ifndef FRAMER_H
+#define FRAMER_H
+
+#include "transport-cpp.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Context::Devices::IO {
+
+// Splits a byte stream into frames: fixed length, behind a 16 or 32 bit
+// length prefix, or ended by a delimiter. Frames lying whole in the data fed
+// are handed out as views into it; only a frame straddling two feeds is
+// copied, into the framer's own buffer. Prefixes and delimiters are not
+// part of the frame
+class TRANSPORT_CPP_EXPORT Framer {
+public:
+  using BYTE = int8_t;
+  using IODATA = std::vector<BYTE>;
+  // The view is only valid during the call. false stops the feed, dropping
+  // whatever was left of it
+  using FRAME_HANDLER = std::function<bool(const BYTE *data, size_t size)>;
+
+  enum class Mode { FIXED_LENGTH, LENGTH_PREFIX, DELIMITER };
+  enum class PrefixSize { U16 = 2, U32 = 4 };
+  enum class Endian { BIG, LITTLE };
+  enum class Status { OK, STOPPED, TOO_LARGE };
+
+  static constexpr size_t DEFAULT_MAX_FRAME = 1 << 20;
+
+private:
+  // where the frame lies within the bytes that make it up
+  struct Span {
+    size_t offset = 0;
+    size_t size = 0;
+    // bytes of input the frame took, 0 when it is not complete yet
+    size_t consumed = 0;
+  };
+
+  Mode mMode = Mode::DELIMITER;
+  size_t mLength = 0;
+  PrefixSize mPrefixSize = PrefixSize::U32;
+  Endian mEndian = Endian::BIG;
+  IODATA mDelimiter = {'\n'};
+  size_t mMaxFrame = DEFAULT_MAX_FRAME;
+  // start of a frame carried over from the previous feed
+  IODATA mPending;
+
+public:
+  // Newline delimited
+  Framer() = default;
+
+  [[nodiscard]] static Framer fixedLength(size_t length);
+  [[nodiscard]] static Framer
+  lengthPrefixed(PrefixSize prefix_size = PrefixSize::U32,
+                 Endian endian = Endian::BIG,
+                 size_t max_frame = DEFAULT_MAX_FRAME);
+  [[nodiscard]] static Framer delimited(const IODATA &delimiter,
+                                        size_t max_frame = DEFAULT_MAX_FRAME);
+  [[nodiscard]] static Framer delimited(BYTE delimiter = '\n',
+                                        size_t max_frame = DEFAULT_MAX_FRAME);
+
+  // False for a zero fixed length or an empty delimiter
+  [[nodiscard]] bool isValid() const noexcept;
+  [[nodiscard]] Mode mode() const noexcept;
+  [[nodiscard]] size_t maxFrameSize() const noexcept;
+
+  // Runs handler for every frame completed by data, keeping the start of
+  // an incomplete one for the next feed. TOO_LARGE means a frame went over
+  // the maximum; the stream can not be resynchronised and the framer resets
+  [[nodiscard]] Status feed(const BYTE *data, size_t size,
+                            const FRAME_HANDLER &handler);
+
+  // Drops any partially received frame
+  void reset() noexcept;
+  [[nodiscard]] size_t pendingBytes() const noexcept;
+
+  // payload as it has to go on the wire to come out of a peer's framer
+  [[nodiscard]] IODATA frame(const IODATA &payload) const;
+
+private:
+  Status nextFrame(const BYTE *data, size_t size, Span &span) const noexcept;
+  Status completePending(const BYTE *data, size_t size, Span &span);
+  Status completePendingDelimited(const BYTE *data, size_t size, Span &span);
+
+  [[nodiscard]] size_t prefixBytes() const noexcept;
+  [[nodiscard]] size_t decodeLength(const BYTE *prefix) const noexcept;
+  [[nodiscard]] const BYTE *findDelimiter(const BYTE *data,
+                                          size_t size) const noexcept;
+};
+
+} // namespace Context::Devices::IO
+
+#endif // FRAMER_H
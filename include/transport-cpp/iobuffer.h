@@ -0,0 +1,99 @@
+#ifndef IOBUFFER_H
+#define IOBUFFER_H
+
+#include "transport-cpp.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Context::Devices::IO {
+class IOBufferPool;
+
+// Reference counted handle to a fixed capacity buffer from an IOBufferPool.
+// Copies share the same bytes; the buffer goes back to its pool once the
+// last handle is dropped, from whichever thread that happens on
+class TRANSPORT_CPP_EXPORT IOBuffer {
+  friend class IOBufferPool;
+
+public:
+  using BYTE = int8_t;
+  using IODATA = std::vector<BYTE>;
+
+private:
+  struct Block;
+
+  Block *mBlock = nullptr;
+
+  explicit IOBuffer(Block *block) noexcept;
+
+public:
+  IOBuffer() = default;
+  ~IOBuffer();
+
+  IOBuffer(const IOBuffer &other) noexcept;
+  IOBuffer(IOBuffer &&other) noexcept;
+  IOBuffer &operator=(const IOBuffer &other) noexcept;
+  IOBuffer &operator=(IOBuffer &&other) noexcept;
+
+  [[nodiscard]] const BYTE *data() const noexcept;
+  [[nodiscard]] BYTE *data() noexcept;
+  [[nodiscard]] size_t size() const noexcept;
+  [[nodiscard]] size_t capacity() const noexcept;
+  [[nodiscard]] bool empty() const noexcept;
+
+  [[nodiscard]] const BYTE *begin() const noexcept;
+  [[nodiscard]] const BYTE *end() const noexcept;
+
+  // Clamped to capacity()
+  void resize(size_t size) noexcept;
+  void reset() noexcept;
+
+  [[nodiscard]] IODATA toIOData() const;
+
+  explicit operator bool() const noexcept;
+};
+
+// Hands out IOBuffers of one size and keeps up to max_cached released ones
+// for reuse, so steady state receives do not touch the heap
+class TRANSPORT_CPP_EXPORT IOBufferPool
+    : public std::enable_shared_from_this<IOBufferPool> {
+  friend class IOBuffer;
+
+public:
+  static constexpr size_t DEFAULT_BUFFER_SIZE = 65536;
+  static constexpr size_t DEFAULT_MAX_CACHED = 64;
+
+private:
+  std::mutex mLock;
+  std::vector<IOBuffer::Block *> mFree;
+  size_t mBufferSize;
+  size_t mMaxCached;
+
+  IOBufferPool(size_t buffer_size, size_t max_cached);
+
+public:
+  [[nodiscard]] static std::shared_ptr<IOBufferPool>
+  create(size_t buffer_size = DEFAULT_BUFFER_SIZE,
+         size_t max_cached = DEFAULT_MAX_CACHED);
+
+  ~IOBufferPool();
+
+  IOBufferPool(const IOBufferPool &) = delete;
+  IOBufferPool &operator=(const IOBufferPool &) = delete;
+
+  // Returns an empty buffer of bufferSize() capacity
+  [[nodiscard]] IOBuffer acquire();
+
+  [[nodiscard]] size_t bufferSize() const noexcept;
+  [[nodiscard]] size_t cachedCount();
+
+private:
+  void recycle(IOBuffer::Block *block) noexcept;
+};
+
+} // namespace Context::Devices::IO
+
+#endif // IOBUFFER_H
@@ -2,11 +2,14 @@
 #define IODEVICE_H
 
 #include "device.h"
+#include "framer.h"
+#include "iobuffer.h"
 
 #include <chrono>
+#include <deque>
 #include <functional>
 #include <memory>
-#include <queue>
+#include <sys/socket.h>
 
 namespace Context::Devices::IO {
 
@@ -17,13 +20,56 @@ public:
   using IODATA_CHOICE =
       std::variant<std::shared_ptr<IODATA>, IODATA, std::unique_ptr<IODATA>>;
 
+  // What an asynchronous send does when its queue is at the limit. REJECT
+  // and a BLOCK that times out return RETURN::FULL, DROP_NEWEST discards
+  // the new message and returns RETURN::PASSABLE
+  enum class QueuePolicy { REJECT, DROP_OLDEST, DROP_NEWEST, BLOCK };
+
+  // Applies to each asynchronous send queue of the device, 0 is unbounded.
+  // An empty queue always takes one message whatever its size
+  struct QueueLimits {
+    size_t max_messages = 0;
+    size_t max_bytes = 0;
+    QueuePolicy policy = QueuePolicy::REJECT;
+    // how long BLOCK may spend writing the queue out to make room
+    std::chrono::milliseconds block_timeout{0};
+  };
+
+  struct QueueStats {
+    uint64_t dropped_messages = 0;
+    uint64_t dropped_bytes = 0;
+    uint64_t rejected = 0;
+  };
+
 private:
   using DEVICE_HANDLE = std::optional<DEVICE_HANDLE_>;
   using IODATA_CALLBACK = std::function<void(const IODATA &)>;
-  using ASYNC_QUEUE = std::queue<IODATA_CHOICE>;
+  using IOBUFFER_CALLBACK = std::function<void(const IOBuffer &)>;
+  using FRAME_CALLBACK = std::function<void(const BYTE *data, size_t size)>;
+  using WATERMARK_CALLBACK = std::function<void(size_t queued_bytes)>;
+  using ASYNC_QUEUE = std::deque<IODATA_CHOICE>;
 
 private:
   IODATA_CALLBACK mCallback;
+  IOBUFFER_CALLBACK mBufferCallback;
+  std::shared_ptr<IOBufferPool> mBufferPool;
+  FRAME_CALLBACK mFrameCallback;
+  std::optional<Framer> mFramer;
+  // bytes of the queue's head already written by a partial write
+  size_t mIOHeadOffset = 0;
+  // bytes in mIOOutgoingQueue still to be written
+  size_t mQueuedBytes = 0;
+  size_t mLowWatermark = 0;
+  size_t mHighWatermark = 0;
+  bool mAboveHighWatermark = false;
+  WATERMARK_CALLBACK mHighWatermarkCallback;
+  WATERMARK_CALLBACK mLowWatermarkCallback;
+  QueueLimits mQueueLimits;
+  QueueStats mQueueStats;
+  // SO_TYPE of the handle, 0 when it is not a socket
+  int mSocketType = 0;
+  // SO_TYPE for the next handle, which was created non-blocking
+  int mPresetSocketType = 0;
 
 protected:
   ASYNC_QUEUE mIOOutgoingQueue;
@@ -40,6 +86,24 @@ public:
 
   void setIODataCallback(const IODATA_CALLBACK &callback);
 
+  // Zero copy receive. While set, incoming data is read straight into
+  // buffers from pool (a default pool when none is given) and handed here
+  // instead of to the IODATA/message callbacks. The callback may keep the
+  // buffer for as long as it likes
+  void setIOBufferCallback(const IOBUFFER_CALLBACK &callback,
+                           std::shared_ptr<IOBufferPool> pool = nullptr);
+
+  // Splits incoming data into frames before any callback sees it. Each
+  // frame goes to the frame callback as a view into the receive buffer,
+  // only valid during the call, and as a copy to the IODATA/message
+  // callbacks. The IOBuffer callback and synchronous receives are not
+  // framed. A frame over the framer's maximum is a read error, which makes
+  // TCP devices drop the connection
+  [[nodiscard]] RETURN_CODE setFraming(const Framer &framer);
+  void clearFraming() noexcept;
+  [[nodiscard]] bool hasFraming() const noexcept;
+  void setFrameCallback(const FRAME_CALLBACK &callback);
+
   [[nodiscard]] virtual RETURN_CODE asyncSend(const IODATA &data);
   [[nodiscard]] virtual RETURN_CODE
   asyncSend(const std::shared_ptr<IODATA> &data);
@@ -52,14 +116,63 @@ public:
   syncReceive(const std::chrono::milliseconds &timeout);
   [[nodiscard]] virtual SYNC_RX_DATA syncReceive();
 
+  // Flow control for asynchronous sends. The high callback fires once the
+  // unsent bytes queued reach high, the low callback once they have drained
+  // back down to low. A high of 0 turns both off
+  [[nodiscard]] RETURN_CODE setSendWatermarks(size_t low, size_t high);
+  void setHighWatermarkCallback(const WATERMARK_CALLBACK &callback);
+  void setLowWatermarkCallback(const WATERMARK_CALLBACK &callback);
+  [[nodiscard]] size_t getQueuedBytes() const noexcept;
+
+  void setSendQueueLimits(const QueueLimits &limits) noexcept;
+  [[nodiscard]] QueueLimits getSendQueueLimits() const noexcept;
+  [[nodiscard]] QueueStats getSendQueueStats() const noexcept;
+  void resetSendQueueStats() noexcept;
+
 protected:
   IODevice();
 
   ERROR readIOData(IODATA &data) const noexcept;
+  // A single read into a pooled buffer, empty without error on end of file
+  ERROR readIOBuffer(IOBuffer &buffer) const;
+  // Reads all that is waiting through the framer, running on_frame for each
+  // frame completed. closed is set on end of file
+  ERROR readFrames(const Framer::FRAME_HANDLER &on_frame, bool &closed);
 
   void notifyIOCallback(const IODATA &data) const;
+  void notifyIOBufferCallback(const IOBuffer &buffer) const;
+  void notifyFrameCallback(const BYTE *data, size_t size) const;
+  [[nodiscard]] bool hasIOBufferCallback() const noexcept;
+  [[nodiscard]] bool hasIODataCallback() const noexcept;
 
   void registerNewHandle(DEVICE_HANDLE handle) override;
+  // For a handle created non-blocking (e.g. by accept4). The next
+  // registerNewHandle takes socket_type as its SO_TYPE and skips the
+  // getsockopt and fcntl calls
+  void expectNonBlockingHandle(int socket_type) noexcept;
+
+  // mIOOutgoingQueue is only changed through these so the queued byte
+  // count stays right
+  void pushOutgoing(IODATA_CHOICE data);
+  void popOutgoing();
+  void updateSendWatermarks();
+
+  // Makes room for size more bytes on mIOOutgoingQueue as the policy says.
+  // RETURN::OK means it may be queued
+  [[nodiscard]] RETURN_CODE admitOutgoing(size_t size);
+  [[nodiscard]] bool sendQueueHasRoom(size_t count, size_t bytes,
+                                      size_t size) const noexcept;
+  void countDropped(size_t size) noexcept;
+  [[nodiscard]] RETURN_CODE rejectOutgoing();
+  // Sends mIOOutgoingQueue one datagram per message with sendmmsg, to dest
+  // when given. False when it would block with messages left over
+  bool drainDatagrams(const sockaddr *dest, socklen_t dest_len);
+  // Blocks until the handle can be written to
+  [[nodiscard]] RETURN_CODE awaitWritable();
+
+  // Waits for the handle to be writable and runs readyWrite until has_room
+  // or the policy's block timeout passes
+  [[nodiscard]] bool blockForRoom(const std::function<bool(void)> &has_room);
 
   void readyWrite() override;
   void readyRead() override;
@@ -71,10 +184,16 @@ protected:
 
   [[nodiscard]] static bool
   ioDataChoiceValid(const IODATA_CHOICE &data) noexcept;
+  [[nodiscard]] static const IODATA &
+  ioDataFromChoice(const IODATA_CHOICE &data) noexcept;
 
 private:
   virtual void ioDataCallbackSet();
 
+  // Write as much of mIOOutgoingQueue as the handle takes, false when it
+  // would block with data left over
+  bool drainStream();
+
   virtual RETURN_CODE performSyncSend(const IODATA_CHOICE &data);
 };
 
@@ -0,0 +1,147 @@
+#ifndef ENDPOINTMAP_H
+#define ENDPOINTMAP_H
+
+#include "networkdevice.h"
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+namespace Context::Devices::IO::Networking {
+
+// Open addressing hash map keyed on Endpoint, probing linearly. Erasing
+// shifts the entries behind back instead of leaving tombstones, so probes
+// stay short while peers come and go. Inserting and erasing invalidate
+// pointers to values
+template <typename VALUE> class EndpointMap {
+  struct Slot {
+    Endpoint key;
+    // empty slot when not set
+    std::optional<VALUE> value;
+  };
+
+  static constexpr size_t MIN_CAPACITY = 16;
+
+private:
+  std::vector<Slot> mSlots;
+  size_t mSize = 0;
+
+public:
+  [[nodiscard]] VALUE *find(const Endpoint &key) noexcept {
+    if (mSize == 0) {
+      return nullptr;
+    }
+
+    const auto index = indexOf(key);
+
+    if (!mSlots[index].value) {
+      return nullptr;
+    }
+
+    return &mSlots[index].value.value();
+  }
+
+  // Replaces the value of a key already present
+  VALUE &insert(const Endpoint &key, VALUE value) {
+    if ((mSize + 1) * 2 > mSlots.size()) {
+      grow();
+    }
+
+    auto &slot = mSlots[indexOf(key)];
+
+    if (!slot.value) {
+      mSize++;
+    }
+
+    slot.key = key;
+    slot.value = std::move(value);
+
+    return slot.value.value();
+  }
+
+  bool erase(const Endpoint &key) noexcept {
+    if (mSize == 0) {
+      return false;
+    }
+
+    const auto mask = mSlots.size() - 1;
+    auto hole = indexOf(key);
+
+    if (!mSlots[hole].value) {
+      return false;
+    }
+
+    mSlots[hole].value.reset();
+    mSize--;
+
+    // pull back every entry of the run that would no longer be found past
+    // the hole
+    for (auto next = (hole + 1) & mask; mSlots[next].value;
+         next = (next + 1) & mask) {
+      const auto home = mSlots[next].key.hash() & mask;
+      const auto reachable = (hole <= next) ? (home > hole && home <= next)
+                                            : (home > hole || home <= next);
+
+      if (reachable) {
+        continue;
+      }
+
+      mSlots[hole].key = mSlots[next].key;
+      mSlots[hole].value = std::move(mSlots[next].value);
+      mSlots[next].value.reset();
+      hole = next;
+    }
+
+    return true;
+  }
+
+  void clear() noexcept {
+    for (auto &slot : mSlots) {
+      slot.value.reset();
+    }
+
+    mSize = 0;
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return mSize; }
+  [[nodiscard]] bool empty() const noexcept { return mSize == 0; }
+
+  // func(const Endpoint &, VALUE &) must not insert or erase
+  template <typename FUNC> void forEach(FUNC &&func) {
+    for (auto &slot : mSlots) {
+      if (slot.value) {
+        func(slot.key, slot.value.value());
+      }
+    }
+  }
+
+private:
+  // Slot holding key, or the empty slot ending its probe
+  [[nodiscard]] size_t indexOf(const Endpoint &key) const noexcept {
+    const auto mask = mSlots.size() - 1;
+    auto index = key.hash() & mask;
+
+    while (mSlots[index].value && mSlots[index].key != key) {
+      index = (index + 1) & mask;
+    }
+
+    return index;
+  }
+
+  void grow() {
+    auto old_slots = std::move(mSlots);
+
+    mSlots = std::vector<Slot>(std::max(MIN_CAPACITY, old_slots.size() * 2));
+    mSize = 0;
+
+    for (auto &slot : old_slots) {
+      if (slot.value) {
+        insert(slot.key, std::move(slot.value.value()));
+      }
+    }
+  }
+};
+
+} // namespace Context::Devices::IO::Networking
+
+#endif // ENDPOINTMAP_H
@@ -1,6 +1,12 @@
 #ifndef NETWORKDEVICE_H
 #define NETWORKDEVICE_H
 
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <sys/socket.h>
+#include <unordered_map>
 #include <utility>
 
 #include "../iodevice.h"
@@ -18,11 +24,46 @@ struct HostAddr {
   PORT port;
 };
 
+struct ResolvedAddr;
+
+// Binary IPv4/IPv6 address and port of a remote end, as the kernel reported
+// it. Cheap to copy, compare and hash; the ip string is only formatted when
+// asked for
+class Endpoint {
+  friend struct ResolvedAddr;
+
+  using ADDR_BYTES = std::array<uint8_t, 16>;
+
+private:
+  sa_family_t mFamily = AF_UNSPEC;
+  PORT mPort = 0;
+  uint32_t mScopeId = 0;
+  // IPv4 addresses use the first 4 bytes
+  ADDR_BYTES mAddr{};
+
+public:
+  Endpoint() = default;
+  // Anything other than AF_INET/AF_INET6 leaves the endpoint invalid
+  explicit Endpoint(const sockaddr_storage &addr) noexcept;
+  explicit Endpoint(const ResolvedAddr &addr) noexcept;
+
+  [[nodiscard]] bool isValid() const noexcept;
+  [[nodiscard]] IPVersion version() const noexcept;
+  [[nodiscard]] PORT port() const noexcept;
+  [[nodiscard]] ADDR ip() const;
+  [[nodiscard]] HostAddr toHostAddr() const;
+
+  [[nodiscard]] size_t hash() const noexcept;
+
+  bool operator==(const Endpoint &other) const noexcept;
+  bool operator!=(const Endpoint &other) const noexcept;
+};
+
 struct NetworkMessage {
   ~NetworkMessage() = default;
 
   IODevice::IODATA data;
-  HostAddr peer;
+  Endpoint peer;
 };
 
 struct ConnectedHost {
@@ -32,6 +73,73 @@ struct ConnectedHost {
   IPVersion ip_hint;
 };
 
+// A destination already resolved to a socket address. Sending to one skips
+// name resolution entirely
+struct ResolvedAddr {
+  ResolvedAddr() = default;
+  ResolvedAddr(const Endpoint &endpoint) noexcept;
+
+  sockaddr_storage addr{};
+  socklen_t addr_len = 0;
+};
+
+// A capacity of 0 turns the cache off
+struct AddrCacheLimits {
+  size_t capacity = 256;
+  // how long a resolved address is trusted before it is resolved again
+  std::chrono::milliseconds ttl{60000};
+};
+
+// Least recently used cache of resolved destinations, keyed by address and
+// IP version
+class AddrCache {
+  using CLOCK = std::chrono::steady_clock;
+
+  struct Key {
+    ADDR ip;
+    PORT port;
+    IPVersion ip_hint;
+
+    bool operator==(const Key &other) const noexcept;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const noexcept;
+  };
+
+  struct Entry {
+    Key key;
+    ResolvedAddr addr;
+    CLOCK::time_point resolved_at;
+  };
+
+  using ENTRY_LIST = std::list<Entry>;
+
+private:
+  AddrCacheLimits mLimits;
+  // most recently used first
+  ENTRY_LIST mEntries;
+  std::unordered_map<Key, ENTRY_LIST::iterator, KeyHash> mIndex;
+
+public:
+  // nullptr when dest is not cached or its entry has expired
+  [[nodiscard]] const ResolvedAddr *find(const HostAddr &dest,
+                                         const IPVersion &ip_hint);
+  void insert(const HostAddr &dest, const IPVersion &ip_hint,
+              const ResolvedAddr &addr);
+
+  void invalidate() noexcept;
+  void invalidate(const HostAddr &dest) noexcept;
+
+  void setLimits(const AddrCacheLimits &limits);
+  [[nodiscard]] AddrCacheLimits getLimits() const noexcept;
+  [[nodiscard]] size_t size() const noexcept;
+
+private:
+  void erase(const Key &key) noexcept;
+  void evictToCapacity() noexcept;
+};
+
 class AddrInfo {
   using AddrInfoReturn = int;
 
@@ -51,38 +159,50 @@ public:
 
 class TRANSPORT_CPP_EXPORT NetworkDevice : public IODevice {
   struct OutgoingMessage {
-    OutgoingMessage(HostAddr in_addr, std::unique_ptr<IODATA> data_ptr,
-                    const IPVersion &version)
-        : addr(std::move(in_addr)), ip_hint(version) {
+    OutgoingMessage(const ResolvedAddr &in_addr,
+                    std::unique_ptr<IODATA> data_ptr)
+        : addr(in_addr) {
       data = std::move(data_ptr);
     }
 
-    OutgoingMessage(HostAddr in_addr, const std::shared_ptr<IODATA> &data_ptr,
-                    const IPVersion &version)
-        : addr(std::move(in_addr)), data(data_ptr), ip_hint(version) {}
+    OutgoingMessage(const ResolvedAddr &in_addr,
+                    const std::shared_ptr<IODATA> &data_ptr)
+        : addr(in_addr), data(data_ptr) {}
 
-    OutgoingMessage(HostAddr in_addr, const IODATA &data_ptr,
-                    const IPVersion &version)
-        : addr(std::move(in_addr)), data(data_ptr), ip_hint(version) {}
+    OutgoingMessage(const ResolvedAddr &in_addr, const IODATA &data_ptr)
+        : addr(in_addr), data(data_ptr) {}
 
-    HostAddr addr;
+    ResolvedAddr addr;
     IODATA_CHOICE data;
-    IPVersion ip_hint;
   };
 
   using RX_CALLBACK = std::function<void(const NetworkMessage &message)>;
+  using RX_BATCH_CALLBACK =
+      std::function<void(const NetworkMessage *messages, size_t count)>;
   using SOCK_STYLE = int;
   using DEVICE_HANDLE = std::optional<DEVICE_HANDLE_>;
   using OUTGOING_MESSAGE = OutgoingMessage;
-  using SEND_QUEUE = std::queue<OUTGOING_MESSAGE>;
+  using SEND_QUEUE = std::deque<OUTGOING_MESSAGE>;
 
 private:
   RX_CALLBACK mCallback;
+  RX_BATCH_CALLBACK mBatchCallback;
   SEND_QUEUE mOutgoingQueue;
+  size_t mOutgoingBytes = 0;
+  AddrCache mAddrCache;
+  std::chrono::microseconds mBusyPoll{0};
+  uint16_t mGsoSegmentSize = 0;
+  bool mGroEnabled = false;
+  bool mReusePort = false;
 
 public:
   void setGenericNetworkCallback(const RX_CALLBACK &callback);
 
+  // Datagram sockets read up to a batch of datagrams per wakeup with
+  // recvmmsg. The batch callback sees them all at once, before each is
+  // handed to the per message callbacks
+  void setBatchNetworkCallback(const RX_BATCH_CALLBACK &callback);
+
   [[nodiscard]] virtual RETURN_CODE
   sendTo(const HostAddr &dest, const IODATA &message,
          const IPVersion &ip_hint = IPVersion::ANY);
@@ -99,14 +219,90 @@ public:
   syncSendTo(const HostAddr &dest, const IODATA_CHOICE &message,
              const IPVersion &ip_hint = IPVersion::ANY);
 
+  [[nodiscard]] virtual RETURN_CODE sendTo(const ResolvedAddr &dest,
+                                           const IODATA &message);
+  [[nodiscard]] virtual RETURN_CODE
+  sendTo(const ResolvedAddr &dest, const std::shared_ptr<IODATA> &message);
+  [[nodiscard]] virtual RETURN_CODE sendTo(const ResolvedAddr &dest,
+                                           std::unique_ptr<IODATA> message);
+  [[nodiscard]] virtual RETURN_CODE
+  syncSendTo(const ResolvedAddr &dest, const IODATA_CHOICE &message);
+
+  // Resolves dest through the device's address cache, calling getaddrinfo
+  // only when it is not cached or its entry has expired
+  [[nodiscard]] RETURN_CODE resolve(const HostAddr &dest, ResolvedAddr &addr,
+                                    const IPVersion &ip_hint = IPVersion::ANY);
+
+  void setAddrCacheLimits(const AddrCacheLimits &limits);
+  [[nodiscard]] AddrCacheLimits getAddrCacheLimits() const noexcept;
+  // Drops every cached address, or only those of dest
+  void invalidateAddrCache() noexcept;
+  void invalidateAddrCache(const HostAddr &dest) noexcept;
+
+  // Sends each message's data to its peer right away with sendmmsg, in
+  // chunks, blocking only while the socket buffer is full. sent counts the
+  // messages that went out, including on failure
+  [[nodiscard]] RETURN_CODE sendBatch(const NetworkMessage *messages,
+                                      size_t count, size_t &sent);
+  [[nodiscard]] RETURN_CODE
+  sendBatch(const std::vector<NetworkMessage> &messages, size_t &sent);
+
   [[nodiscard]] RETURN_CODE getLocalAddress(HostAddr &addr) noexcept;
 
+  // Sets SO_BUSY_POLL so the kernel polls the NIC queue on reads for up to
+  // budget. Kept for sockets created later; raising it above the
+  // net.core.busy_read sysctl needs CAP_NET_ADMIN
+  [[nodiscard]] RETURN_CODE
+  setBusyPoll(const std::chrono::microseconds &budget) noexcept;
+
+  // UDP segmentation offload. Sends longer than segment_size are split into
+  // datagrams of segment_size by the kernel (or NIC); one send may carry at
+  // most 64 segments and 64 KB. 0 turns it off. Kept for sockets created
+  // later
+  [[nodiscard]] RETURN_CODE setGsoSegmentSize(uint16_t segment_size) noexcept;
+
+  // Lets several sockets bind the same address and port (SO_REUSEPORT), the
+  // kernel then spreads connections/datagrams across them. Applies to
+  // sockets bound after the call
+  void setReusePort(bool enable) noexcept;
+  [[nodiscard]] bool getReusePort() const noexcept;
+
+  // Replaces the kernel's hash based spreading over the SO_REUSEPORT group
+  // of this (bound) socket: traffic handled on CPU n goes to the socket that
+  // joined the group (n % group_size)th. With one socket per pinned engine
+  // thread, a flow stays on the CPU that received it
+  [[nodiscard]] RETURN_CODE
+  attachReusePortCpuSteering(unsigned group_size) noexcept;
+
+  // UDP receive offload. The kernel may coalesce datagrams from one peer,
+  // they are split apart again before the message callbacks see them. The
+  // IOBuffer callback receives coalesced data as it is
+  [[nodiscard]] RETURN_CODE setGroEnabled(bool enable) noexcept;
+
 protected:
+  // Reused between reads so the message buffers keep their capacity
+  std::vector<NetworkMessage> mReceiveBatch;
+  // Reused for the frames copied out to the message callbacks
+  NetworkMessage mFrameMessage;
+
   NetworkDevice();
 
-  ERROR receiveMessage(NetworkMessage &message) const;
+  void registerNewHandle(DEVICE_HANDLE handle) override;
+
+  // Reads the pending datagrams into the first count entries of
+  // mReceiveBatch, one message per datagram
+  ERROR receiveMessages(size_t &count);
 
   void notifyCallback(const NetworkMessage &message) const;
+  void notifyBatchCallback(const NetworkMessage *messages, size_t count) const;
+  // Whether notifyCallback has anyone to tell
+  [[nodiscard]] bool hasMessageCallback() const noexcept;
+
+  // Address of the connected remote end of the socket
+  [[nodiscard]] RETURN_CODE getRemoteEndpoint(Endpoint &endpoint) noexcept;
+  // Size of the datagrams coalesced into a GRO read, length when there is
+  // no segment size attached
+  static size_t groSegmentSize(const msghdr &header, size_t length) noexcept;
 
   RETURN_CODE createAndConnectSocket(const HostAddr &host,
                                      const IPVersion &ip_hint,
@@ -122,8 +318,19 @@ protected:
   void readyWrite() override;
 
 private:
-  RETURN_CODE performSendTo(const HostAddr &dest, const IODATA_CHOICE &data,
-                            const IPVersion &ip_hint);
+  RETURN_CODE performSendTo(const ResolvedAddr &dest,
+                            const IODATA_CHOICE &data);
+  // getaddrinfo without the cache
+  RETURN_CODE resolveAddress(const HostAddr &dest, const IPVersion &ip_hint,
+                             ResolvedAddr &addr);
+  // sendmmsg as much of mOutgoingQueue as the socket takes, false when it
+  // would block with messages left over
+  bool drainOutgoingMessages();
+  [[nodiscard]] RETURN_CODE admitOutgoingMessage(size_t size);
+  void popOutgoingMessage();
+  RETURN_CODE applyBusyPoll() noexcept;
+  RETURN_CODE applyGso() noexcept;
+  RETURN_CODE applyGro() noexcept;
 };
 
 struct Interface {
@@ -142,4 +349,13 @@ ADDR getLocalBroadcasterAddr(const std::string &if_name);
 bool ifaceExists(const std::string &if_name);
 } // namespace Context::Devices::IO::Networking
 
+namespace std {
+template <> struct hash<Context::Devices::IO::Networking::Endpoint> {
+  size_t operator()(const Context::Devices::IO::Networking::Endpoint
+                        &endpoint) const noexcept {
+    return endpoint.hash();
+  }
+};
+} // namespace std
+
 #endif // NETWORKDEVICE_H
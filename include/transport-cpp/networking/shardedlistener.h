@@ -0,0 +1,165 @@
+#ifndef SHARDEDLISTENER_H
+#define SHARDEDLISTENER_H
+
+#include "../enginepool.h"
+#include "networkdevice.h"
+
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace Context::Devices::IO::Networking {
+
+// One listener (TCP::Server::Acceptor, UDP::Server) per engine of a pool,
+// all bound to the same port with SO_REUSEPORT so accepting and receiving
+// scale with the pool's threads. Set up every shard's handlers before bind;
+// once bound each shard belongs to its engine's thread. Destroying the
+// listener waits for every engine to let go of its shard, so it must not
+// happen on one of the pool's threads
+template <typename LISTENER> class ShardedListener {
+  using SHARD = std::unique_ptr<LISTENER>;
+  using SHARD_LIST = std::vector<SHARD>;
+
+public:
+  // How the kernel picks the shard of a new connection or datagram
+  enum class Steering { HASH, CPU };
+
+private:
+  EnginePool &mPool;
+  SHARD_LIST mShards;
+  // shards handed to their engines, always the first ones
+  size_t mRegistered = 0;
+  Device::ERROR mLastError = {Device::ERROR_CODE::NO_ERROR, ""};
+
+public:
+  explicit ShardedListener(EnginePool &pool) : mPool(pool) {
+    for (size_t x = 0; x < mPool.size(); x++) {
+      mShards.push_back(std::make_unique<LISTENER>());
+      mShards.back()->setReusePort(true);
+    }
+  }
+
+  ~ShardedListener() { deregister(); }
+
+  ShardedListener(const ShardedListener &) = delete;
+  ShardedListener &operator=(const ShardedListener &) = delete;
+
+  [[nodiscard]] size_t size() const noexcept { return mShards.size(); }
+
+  // Shard x runs on engine x of the pool
+  [[nodiscard]] LISTENER &shard(size_t index) { return *mShards.at(index); }
+
+  template <typename FUNC> void forEach(FUNC &&func) {
+    for (auto &shard : mShards) {
+      func(*shard);
+    }
+  }
+
+  // Binds every shard in order and registers it with its engine. With port
+  // 0 the first shard picks the port and the others join it. CPU steering
+  // keeps a flow on the CPU that received it, which pays off when the pool
+  // pins its threads
+  [[nodiscard]] RETURN_CODE bind(const HostAddr &host,
+                                 IPVersion ip_hint = IPVersion::ANY,
+                                 Steering steering = Steering::HASH) {
+    auto shared = host;
+
+    for (auto &shard : mShards) {
+      if (shard->bind(shared, ip_hint) == RETURN::NOK) {
+        return fail(*shard);
+      }
+
+      if (shared.port == 0) {
+        HostAddr local;
+
+        if (shard->getLocalAddress(local) == RETURN::NOK) {
+          return fail(*shard);
+        }
+
+        shared.port = local.port;
+      }
+    }
+
+    if (steering == Steering::CPU &&
+        mShards.front()->attachReusePortCpuSteering(
+            static_cast<unsigned>(mShards.size())) == RETURN::NOK) {
+      return fail(*mShards.front());
+    }
+
+    for (size_t x = 0; x < mShards.size(); x++) {
+      if (mPool.registerDevice(*mShards[x], x) == RETURN::NOK) {
+        deregister();
+        fail(*mShards[x]);
+
+        mLastError = {Device::ERROR_CODE::GENERAL_ERROR,
+                      "Unable to register shard with its engine"};
+        return RETURN::NOK;
+      }
+
+      mRegistered = x + 1;
+    }
+
+    return RETURN::OK;
+  }
+
+  [[nodiscard]] Device::ERROR getLastError() const noexcept {
+    return mLastError;
+  }
+
+private:
+  // Takes the registered shards off their engines on the engines' own
+  // threads and waits until each is done. Registration itself is a posted
+  // task, so one still queued runs first
+  void deregister() {
+    for (size_t x = 0; x < mRegistered; x++) {
+      auto &engine = mPool.engine(x);
+      auto shard = mShards[x].get();
+      auto done = std::make_shared<std::promise<void>>();
+      auto deregistered = done->get_future();
+
+      const auto posted = mPool.post(x, [&engine, shard, done] {
+        (void)engine.deRegisterDevice(*shard);
+        done->set_value();
+      });
+
+      if (!mPool.isRunning()) {
+        // no thread drives the engine, so its queue is run from here
+        engine.runPostedTasks();
+
+        if (posted == RETURN::NOK) {
+          (void)engine.deRegisterDevice(*shard);
+        }
+
+        continue;
+      }
+
+      if (posted == RETURN::NOK) {
+        // the engine may still be polling the shard, leaking it is the
+        // only safe way out
+        (void)mShards[x].release();
+        continue;
+      }
+
+      deregistered.wait();
+    }
+
+    mRegistered = 0;
+  }
+
+  RETURN_CODE fail(const LISTENER &shard) {
+    mLastError = shard.getLastError();
+
+    for (auto &bound : mShards) {
+      // a shard leaked by deregister is gone
+      if (bound) {
+        bound->disconnect();
+      }
+    }
+
+    return RETURN::NOK;
+  }
+};
+
+} // namespace Context::Devices::IO::Networking
+
+#endif // SHARDEDLISTENER_H
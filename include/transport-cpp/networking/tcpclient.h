@@ -1,29 +1,90 @@
 #ifndef TCPCLIENT_H
 #define TCPCLIENT_H
 
+#include "../timerwheel.h"
 #include "networkdevice.h"
 
+#include <deque>
+#include <future>
+#include <unordered_map>
+
 namespace Context::Devices::IO::Networking::TCP {
 
 class TRANSPORT_CPP_EXPORT Client final : public NetworkDevice {
   using DISCONNECT_NOTIFY = std::function<void(Client *)>;
 
+public:
+  using CORRELATION_ID = uint64_t;
+  // Picks the correlation id out of a request or a response, nullopt when
+  // it carries none
+  using CORRELATION_EXTRACTOR =
+      std::function<std::optional<CORRELATION_ID>(const IODATA &)>;
+
+  // Outcome of an asynchronous request, error says why when code is NOK
+  struct Response {
+    RETURN_CODE code{};
+    std::optional<IODATA> data;
+    ERROR error;
+  };
+
+  using RESPONSE_HANDLER = std::function<void(const Response &)>;
+  // OK once connected, NOK when the connect failed (getLastError says why)
+  using CONNECT_HANDLER = std::function<void(Client *, RETURN_CODE)>;
+
 private:
+  struct PendingRequest {
+    // empty once a request matched in order has timed out
+    RESPONSE_HANDLER handler;
+    WheelTimer timer;
+
+    PendingRequest(Engine &engine, const RESPONSE_HANDLER &response_handler);
+  };
+
   ConnectedHost mHost;
+  Endpoint mPeerEndpoint;
   DISCONNECT_NOTIFY mToNotify;
   bool mIsConnected = false;
 
+  // set while a non-blocking connect is under way
+  CONNECT_HANDLER mConnectHandler;
+  std::unique_ptr<WheelTimer> mConnectTimer;
+  bool mIsConnecting = false;
+
+  CORRELATION_EXTRACTOR mCorrelationExtractor;
+  std::unordered_map<CORRELATION_ID, PendingRequest> mInFlight;
+  // keys of requests matched in order, oldest first. A key no longer in
+  // mInFlight timed out, its late reply is passed over when it comes
+  std::deque<CORRELATION_ID> mRequestOrder;
+  size_t mSkippedReplies = 0;
+  CORRELATION_ID mNextSequence = 0;
+
 public:
   Client();
 
   ConnectedHost getSetHostAddr();
   void disconnect();
+  [[nodiscard]] bool isConnected() const noexcept;
 
   [[nodiscard]] RETURN_CODE
   connectToHost(const HostAddr &host,
                 const IPVersion &ip_hint = IPVersion::ANY);
   [[nodiscard]] RETURN_CODE connectToHost(const ConnectedHost &host);
 
+  // Connects without blocking the engine. The client must be registered
+  // with one; handler runs on its thread once the connect has succeeded or
+  // failed, and must not destroy the client. Only resolving a name missing
+  // from the address cache blocks, in getaddrinfo. Data sent before the
+  // handler runs is queued. A timeout of 0 leaves it to the kernel
+  [[nodiscard]] RETURN_CODE asyncConnectToHost(
+      const ConnectedHost &host, const CONNECT_HANDLER &handler,
+      const std::chrono::milliseconds &timeout = std::chrono::milliseconds{0});
+  // As above, to addr already resolved for host
+  [[nodiscard]] RETURN_CODE asyncConnectToHost(
+      const ConnectedHost &host, const ResolvedAddr &addr,
+      const CONNECT_HANDLER &handler,
+      const std::chrono::milliseconds &timeout = std::chrono::milliseconds{0});
+  [[nodiscard]] bool isConnecting() const noexcept;
+
   void setDisconnectNotification(const DISCONNECT_NOTIFY &handler);
 
   [[nodiscard]] SYNC_RX_DATA syncRequestResponse(const IODATA &data);
@@ -31,13 +92,51 @@ public:
   syncRequestResponse(const IODATA &data,
                       const std::chrono::milliseconds &timeout);
 
+  // Pipelined requests, any number may be in flight. Each response goes to
+  // its request's handler rather than the message callbacks, matched by the
+  // correlation extractor when one is set and otherwise in the order the
+  // requests were sent. A response is one frame, so framing must be set
+  // (see setFraming) and no IOBuffer callback may be. A bounded send queue
+  // must not use QueuePolicy::DROP_OLDEST, which could evict a request
+  // already counted as in flight. Needs an engine; a timeout of 0 waits
+  // forever
+  [[nodiscard]] RETURN_CODE
+  setCorrelationExtractor(const CORRELATION_EXTRACTOR &extractor);
+  [[nodiscard]] RETURN_CODE
+  asyncRequest(const IODATA &data, const RESPONSE_HANDLER &handler,
+               const std::chrono::milliseconds &timeout =
+                   std::chrono::milliseconds{0});
+  // Fulfilled on the engine's thread, so never wait on it from there
+  [[nodiscard]] std::future<Response>
+  asyncRequest(const IODATA &data, const std::chrono::milliseconds &timeout =
+                                       std::chrono::milliseconds{0});
+  [[nodiscard]] size_t getInFlightCount() const noexcept;
+  // Replies still due for requests matched in order that timed out
+  [[nodiscard]] size_t getSkippedReplyCount() const noexcept;
+
 private:
   void readyRead() override;
+  void readyReadBuffer();
+  void readyReadFrames();
+  void readyWrite() override;
   void readyHangup() override;
   void readyPeerDisconnect() override;
+  void readyError() override;
+
+  // Settles a non-blocking connect once the socket reports an event
+  void finishConnect();
+  void connectTimedOut();
+  void endConnect(RETURN_CODE code);
 
+  void notifyFrame(const BYTE *data, size_t size);
   void notifyOfDisconnect();
   void peerDisconnected();
+
+  // True when response belonged to a request, it is then moved out
+  bool completeRequest(IODATA &response);
+  void requestTimedOut(CORRELATION_ID key);
+  void failInFlight(const ERROR &error);
+  void engineChanged(Engine *engine) override;
 };
 
 } // namespace Context::Devices::IO::Networking::TCP
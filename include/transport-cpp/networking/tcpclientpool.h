@@ -0,0 +1,191 @@
+#ifndef TCPCLIENTPOOL_H
+#define TCPCLIENTPOOL_H
+
+#include "../timerwheel.h"
+#include "tcpclient.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Context::Devices::IO::Networking::TCP {
+
+// Keeps connected Clients per host for reuse and hands them out as leases.
+// Idle connections are health checked before reuse, closed after the idle
+// timeout and, down to min_idle per host, replaced with backoff when the
+// peer drops them. New connections are made without blocking the engine,
+// with host names resolved once per address cache lifetime. Clients live on
+// the pool's engine; the pool must be used from that engine's thread and
+// outlive its leases
+class TRANSPORT_CPP_EXPORT ClientPool {
+public:
+  struct Limits {
+    // leased plus idle connections per host, 0 is unbounded
+    size_t max_per_host = 8;
+    // idle connections kept open per host once it has been used
+    size_t min_idle = 0;
+    // 0 keeps idle connections until the peer closes them
+    std::chrono::milliseconds idle_timeout{30000};
+    std::chrono::milliseconds reconnect_min{100};
+    std::chrono::milliseconds reconnect_max{10000};
+    // 0 leaves a connect that gets no answer to the kernel's timeout
+    std::chrono::milliseconds connect_timeout{5000};
+  };
+
+  struct Stats {
+    // acquires served by an idle connection, and by a new one
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t connects = 0;
+    uint64_t connect_failures = 0;
+    // idle connections found dead or with unread data on acquire
+    uint64_t health_check_failures = 0;
+    uint64_t idle_evictions = 0;
+    uint64_t reconnect_attempts = 0;
+    std::chrono::microseconds connect_time_total{0};
+    std::chrono::microseconds last_connect_time{0};
+  };
+
+  // Sole owner of a leased Client. Going out of scope returns the client to
+  // the pool; callbacks set on it during the lease are cleared then
+  class TRANSPORT_CPP_EXPORT Lease {
+    friend class ClientPool;
+
+  private:
+    ClientPool *mPool = nullptr;
+    std::string mKey;
+    std::unique_ptr<Client> mClient;
+
+    Lease(ClientPool *pool, std::string key,
+          std::unique_ptr<Client> client) noexcept;
+
+  public:
+    Lease() = default;
+    ~Lease();
+
+    Lease(Lease &&other) noexcept = default;
+    Lease &operator=(Lease &&other) noexcept;
+    Lease(const Lease &) = delete;
+    Lease &operator=(const Lease &) = delete;
+
+    [[nodiscard]] Client *get() const noexcept;
+    Client *operator->() const noexcept;
+    Client &operator*() const noexcept;
+    explicit operator bool() const noexcept;
+
+    // Hands the client back now
+    void release();
+    // Closes the connection instead of returning it, e.g. after a protocol
+    // error left it in an unknown state
+    void discard();
+  };
+
+  using LEASE_HANDLER = std::function<void(Lease lease)>;
+
+private:
+  struct IdleClient {
+    std::unique_ptr<Client> client;
+    WheelTimer idle_timer;
+
+    IdleClient(Engine &engine, std::unique_ptr<Client> idle_client);
+  };
+
+  struct ConnectingClient {
+    std::unique_ptr<Client> client;
+    // the acquire waiting for it, empty when it is meant to idle
+    LEASE_HANDLER waiter;
+    std::chrono::steady_clock::time_point started;
+  };
+
+  struct HostPool {
+    ConnectedHost host;
+    // most recently returned last, reuse takes from the back so the rest
+    // can idle out
+    std::vector<std::unique_ptr<IdleClient>> idle;
+    std::vector<std::unique_ptr<ConnectingClient>> connecting;
+    size_t leased = 0;
+    std::chrono::milliseconds backoff{0};
+    std::unique_ptr<WheelTimer> reconnect_timer;
+  };
+
+  Engine &mEngine;
+  Limits mLimits;
+  Stats mStats;
+  std::unordered_map<std::string, HostPool> mHosts;
+  AddrCache mAddrCache;
+  Device::ERROR mLastError = {Device::ERROR_CODE::NO_ERROR, ""};
+
+public:
+  explicit ClientPool(Engine &engine);
+  ~ClientPool();
+
+  ClientPool(const ClientPool &) = delete;
+  ClientPool &operator=(const ClientPool &) = delete;
+
+  // Hands handler a healthy idle connection right away, before acquire
+  // returns, or else a new one once it is connected. A connect that fails
+  // hands over an empty lease, see getLastError. FULL when the host is at
+  // max_per_host and NOK when no connect could be started; handler is not
+  // called then
+  [[nodiscard]] RETURN_CODE acquire(const ConnectedHost &host,
+                                    const LEASE_HANDLER &handler);
+  // Starts connections to host until min_idle of them are idle or on the
+  // way there
+  [[nodiscard]] RETURN_CODE warm(const ConnectedHost &host);
+
+  void setLimits(const Limits &limits);
+  [[nodiscard]] Limits getLimits() const noexcept;
+
+  [[nodiscard]] Stats getStats() const noexcept;
+  void resetStats() noexcept;
+  // hits over acquires, 0 before the first
+  [[nodiscard]] double getHitRatio() const noexcept;
+  [[nodiscard]] std::chrono::microseconds
+  getAverageConnectTime() const noexcept;
+
+  [[nodiscard]] size_t getIdleCount(const ConnectedHost &host) const;
+  [[nodiscard]] size_t getLeasedCount(const ConnectedHost &host) const;
+  [[nodiscard]] size_t getConnectingCount(const ConnectedHost &host) const;
+
+  // Closes every idle connection and drops those being made to idle, leases
+  // and acquires still waiting are unaffected
+  void clear();
+
+  [[nodiscard]] Device::ERROR getLastError() const noexcept;
+
+private:
+  [[nodiscard]] static std::string keyOf(const ConnectedHost &host);
+  HostPool &hostPool(const ConnectedHost &host);
+
+  // Starts a connect handed to waiter once done, or added to the idle
+  // connections when there is no waiter
+  RETURN_CODE connect(const std::string &key, HostPool &pool,
+                      const LEASE_HANDLER &waiter);
+  void connectFinished(const std::string &key, const Client *client,
+                       RETURN_CODE code);
+  RETURN_CODE resolve(Client &client, const ConnectedHost &host,
+                      ResolvedAddr &addr);
+  // connects under way that are meant to idle
+  [[nodiscard]] static size_t pendingIdle(const HostPool &pool) noexcept;
+  [[nodiscard]] static bool isHealthy(const Client &client);
+  void addIdle(const std::string &key, HostPool &pool,
+               std::unique_ptr<Client> client);
+  std::unique_ptr<Client> takeIdle(HostPool &pool, const Client *client);
+  void release(const std::string &key, std::unique_ptr<Client> client,
+               bool discard);
+
+  void idleExpired(const std::string &key, const Client *client);
+  void idleDisconnected(const std::string &key, const Client *client);
+  // Starts the reconnect timer if the host is below min_idle
+  void replenish(const std::string &key, HostPool &pool);
+  void reconnect(const std::string &key);
+
+  // Destroys client once the engine is done with the current event, it may
+  // be in the middle of one of its own callbacks
+  void dispose(std::unique_ptr<Client> client);
+};
+
+} // namespace Context::Devices::IO::Networking::TCP
+
+#endif // TCPCLIENTPOOL_H
@@ -1,6 +1,7 @@
 #ifndef TCPSERVER_H
 #define TCPSERVER_H
 
+#include "../enginepool.h"
 #include "networkdevice.h"
 
 namespace Context::Devices::IO::Networking::TCP::Server {
@@ -17,22 +18,26 @@ class TRANSPORT_CPP_EXPORT Peer : public NetworkDevice {
 private:
   NEW_REQUEST_HANDLER mRequestHandler;
   PEER_DISCONNECT_HANDLER mDisconnectHandler;
-  const HostAddr mPeerAddr;
+  const Endpoint mPeerEndpoint;
   bool mIsConnected = false;
 
 public:
   void setRequestHandler(NEW_REQUEST_HANDLER handler) noexcept;
   void setDisconnectHandler(PEER_DISCONNECT_HANDLER handler) noexcept;
-  HostAddr getPeerAddr() const noexcept;
+  HostAddr getPeerAddr() const;
+  const Endpoint &getPeerEndpoint() const noexcept;
 
 private:
-  Peer(DEVICE_HANDLE_ handle, const HostAddr &peer_addr) noexcept;
+  Peer(DEVICE_HANDLE_ handle, const Endpoint &peer_endpoint) noexcept;
 
   void readyRead() override;
+  void readyReadBuffer();
+  void readyReadFrames();
   void readyHangup() override;
   void readyPeerDisconnect() override;
 
   void peerDisconnected();
+  void notifyFrame(const BYTE *data, size_t size);
   void notifyServerHandler(const NetworkMessage &request);
 };
 
@@ -50,14 +55,28 @@ private:
   ConnectedHost mAddr;
   NEW_PEER_HANDLER mHandleNewPeer;
   bool mIsBound = false;
+  size_t mAcceptBatchSize = 64;
+  EnginePool *mPeerPool = nullptr;
+  EnginePool::Placement mPeerPlacement = EnginePool::Placement::ROUND_ROBIN;
 
 public:
   Acceptor() noexcept;
   void disconnect();
 
   void setNewPeerHandler(NEW_PEER_HANDLER handler) noexcept;
+
+  // Accepted peers are registered on an engine from the pool and the new
+  // peer handler runs on that engine's thread. nullptr restores the default
+  // of registering peers alongside the acceptor
+  void distributePeers(EnginePool *pool,
+                       EnginePool::Placement placement =
+                           EnginePool::Placement::ROUND_ROBIN) noexcept;
   [[nodiscard]] bool isBound() const noexcept;
 
+  // Most connections taken off the backlog per wakeup, at least 1
+  void setAcceptBatchSize(size_t batch_size) noexcept;
+  [[nodiscard]] size_t getAcceptBatchSize() const noexcept;
+
   [[nodiscard]] RETURN_CODE bind(PORT port,
                                  IPVersion ip_hint = IPVersion::ANY) noexcept;
   [[nodiscard]] RETURN_CODE bind(const HostAddr &host,
@@ -70,7 +89,9 @@ private:
   void readyRead() override;
   void readyHangup() override;
 
+  void acceptPeer(DEVICE_HANDLE_ handle, const sockaddr_storage &addr);
   void notifyNewPeer(std::unique_ptr<Peer> new_peer) const;
+  void dispatchToPool(std::unique_ptr<Peer> new_peer);
 };
 
 } // namespace Context::Devices::IO::Networking::TCP::Server
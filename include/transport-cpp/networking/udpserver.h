@@ -1,6 +1,8 @@
 #ifndef UDPSERVER_H
 #define UDPSERVER_H
 
+#include "../timerwheel.h"
+#include "endpointmap.h"
 #include "networkdevice.h"
 
 namespace Context::Devices::IO::Networking::UDP {
@@ -9,14 +11,14 @@ class Server;
 class TRANSPORT_CPP_EXPORT Peer final : public NetworkDevice {
   friend class Server;
   using DESTROY_NOTIFIER = std::function<void(Peer *)>;
-  using SYNC_SEND = std::function<RETURN_CODE(
-      const HostAddr &, const IODATA_CHOICE &, const IPVersion &)>;
-  using ASYNC_SEND_PLAIN = std::function<RETURN_CODE(
-      const HostAddr &, const IODATA &, const IPVersion &)>;
+  using SYNC_SEND =
+      std::function<RETURN_CODE(const ResolvedAddr &, const IODATA_CHOICE &)>;
+  using ASYNC_SEND_PLAIN =
+      std::function<RETURN_CODE(const ResolvedAddr &, const IODATA &)>;
   using ASYNC_SEND_SHARED = std::function<RETURN_CODE(
-      const HostAddr &, const std::shared_ptr<IODATA> &, const IPVersion &)>;
+      const ResolvedAddr &, const std::shared_ptr<IODATA> &)>;
   using ASYNC_SEND_UNIQUE = std::function<RETURN_CODE(
-      const HostAddr &, std::unique_ptr<IODATA>, const IPVersion &)>;
+      const ResolvedAddr &, std::unique_ptr<IODATA>)>;
 
   using NETWORK_MSG_CALLBACK =
       std::function<void(const NetworkMessage &message)>;
@@ -30,7 +32,9 @@ private:
   NETWORK_MSG_CALLBACK mNewMessage;
 
   bool mIsValid = false;
-  HostAddr mPeerAddr;
+  Endpoint mPeerEndpoint;
+  // built once when the peer is created, replies skip the lookup
+  ResolvedAddr mResolvedPeerAddr;
 
 private:
   Peer();
@@ -44,7 +48,8 @@ public:
 
   void setMessageHandler(const NETWORK_MSG_CALLBACK &handler);
 
-  [[nodiscard]] HostAddr getPeerAddress() const noexcept;
+  [[nodiscard]] HostAddr getPeerAddress() const;
+  [[nodiscard]] const Endpoint &getPeerEndpoint() const noexcept;
   [[nodiscard]] bool isValid() const noexcept;
   [[nodiscard]] RETURN_CODE
   sendTo(const HostAddr &dest, const IODATA &message,
@@ -62,6 +67,17 @@ public:
   syncSendTo(const HostAddr &dest, const IODATA_CHOICE &message,
              const IPVersion &ip_hint = IPVersion::ANY) override;
 
+  [[nodiscard]] RETURN_CODE sendTo(const ResolvedAddr &dest,
+                                   const IODATA &message) override;
+  [[nodiscard]] RETURN_CODE
+  sendTo(const ResolvedAddr &dest,
+         const std::shared_ptr<IODATA> &message) override;
+  [[nodiscard]] RETURN_CODE sendTo(const ResolvedAddr &dest,
+                                   std::unique_ptr<IODATA> message) override;
+  [[nodiscard]] RETURN_CODE
+  syncSendTo(const ResolvedAddr &dest,
+             const IODATA_CHOICE &message) override;
+
   [[nodiscard]] RETURN_CODE asyncSend(const IODATA &data) override;
   [[nodiscard]] RETURN_CODE
   asyncSend(const std::shared_ptr<IODATA> &data) override;
@@ -73,17 +89,40 @@ public:
 
 class TRANSPORT_CPP_EXPORT Server final : public NetworkDevice {
   using PEER = std::unique_ptr<Peer>;
-  using PEER_LIST = std::vector<Peer *>;
+  using CLOCK = std::chrono::steady_clock;
 
   using NEW_PEER_NOTIFY = std::function<void(const NetworkMessage &, PEER)>;
+  using PEER_EXPIRED_NOTIFY = std::function<void(Peer *)>;
+
+  struct PeerEntry {
+    Peer *peer = nullptr;
+    // only kept while an idle timeout is set and the server has an engine
+    std::unique_ptr<WheelTimer> idle_timer;
+    CLOCK::time_point last_seen;
+  };
+
+  using PEER_TABLE = EndpointMap<PeerEntry>;
+
+public:
+  // Sources beyond max_peers (0 for no limit) still reach the generic
+  // callbacks but get no Peer. A peer that has received nothing for
+  // idle_timeout (0 for never) is invalidated and handed to the expiry
+  // handler; this needs the server registered with an engine
+  struct PeerLimits {
+    size_t max_peers = 0;
+    std::chrono::milliseconds idle_timeout{0};
+  };
 
 private:
-  HostAddr mLastPeer;
+  Endpoint mLastPeer;
   ConnectedHost mAddr;
   bool mPeerConnected = false;
   bool mBound = false;
-  PEER_LIST mPeers;
+  PEER_TABLE mPeers;
+  PeerLimits mPeerLimits;
+  uint64_t mRejectedPeers = 0;
   NEW_PEER_NOTIFY mNewPeerNotify;
+  PEER_EXPIRED_NOTIFY mPeerExpiredNotify;
 
 public:
   Server();
@@ -93,6 +132,15 @@ public:
   void disconnect() noexcept;
 
   void setNewPeerHandler(const NEW_PEER_NOTIFY &handler);
+  // The expired peer is already invalid, the handler may destroy it
+  void setPeerExpiredHandler(const PEER_EXPIRED_NOTIFY &handler);
+
+  // Call from the engine's thread once registered
+  void setPeerLimits(const PeerLimits &limits);
+  [[nodiscard]] PeerLimits getPeerLimits() const noexcept;
+  [[nodiscard]] size_t getPeerCount() const noexcept;
+  // New sources turned away by max_peers
+  [[nodiscard]] uint64_t getRejectedPeerCount() const noexcept;
 
   [[nodiscard]] RETURN_CODE bind(const HostAddr &host,
                                  const IPVersion &ip_hint = IPVersion::ANY);
@@ -107,8 +155,12 @@ public:
 
 private:
   void peerDestroyed(const Peer *peer);
+  void armIdleTimer(const Endpoint &endpoint, PeerEntry &entry);
+  void checkIdlePeer(const Endpoint &endpoint);
 
+  void engineChanged(Engine *engine) override;
   void readyRead() override;
+  void routeMessage(const NetworkMessage &data);
 };
 } // namespace Context::Devices::IO::Networking::UDP
 
@@ -0,0 +1,44 @@
+#ifndef TASKQUEUE_H
+#define TASKQUEUE_H
+
+#include "transport-cpp.h"
+
+#include <atomic>
+#include <functional>
+
+namespace Context {
+
+// Lock-free multi producer, single consumer queue of tasks. push() may be
+// called from any thread, pop() only from the consuming thread
+class TRANSPORT_CPP_EXPORT TaskQueue {
+public:
+  using TASK = std::function<void()>;
+
+private:
+  struct Node {
+    std::atomic<Node *> next{nullptr};
+    TASK task;
+  };
+
+  // producers swap themselves in at the head, the consumer walks from the
+  // tail. The tail is always a drained stub node
+  std::atomic<Node *> mHead;
+  Node *mTail;
+
+public:
+  TaskQueue();
+  ~TaskQueue();
+
+  TaskQueue(const TaskQueue &) = delete;
+  TaskQueue &operator=(const TaskQueue &) = delete;
+
+  void push(TASK task);
+
+  // Returns false when empty, or when the next producer has not finished
+  // linking its task in yet
+  [[nodiscard]] bool pop(TASK &task);
+};
+
+} // namespace Context
+
+#endif // TASKQUEUE_H
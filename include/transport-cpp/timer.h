@@ -6,31 +6,61 @@
 #define TIMER_H
 
 #include <chrono>
+#include <cstdint>
+#include <ctime>
 #include <functional>
+#include <optional>
 #include <transport-cpp/device.h>
 
 namespace Context {
 
 class TRANSPORT_CPP_EXPORT Timer : public Device {
+public:
+  enum class Mode { PERIODIC, ONE_SHOT };
+
+  // Receives the number of expirations since the last callback, anything
+  // above 1 means ticks were missed
+  using EXPIRY_CALLBACK = std::function<void(uint64_t)>;
+
 private:
   bool mIsRunning;
-  std::chrono::milliseconds mSetDuration;
-  std::function<void(void)> mCallback;
+  Mode mMode = Mode::PERIODIC;
+  // the interval when started at a deadline
+  std::chrono::nanoseconds mSetDuration;
+  std::optional<std::chrono::steady_clock::time_point> mSetDeadline;
+  EXPIRY_CALLBACK mCallback;
 
 public:
   Timer();
   ~Timer() override;
 
   RETURN_CODE stop() noexcept;
+  // Starts again from now with the duration and mode last given to start(),
+  // or re-arms the deadline and interval last given to startAt(). A deadline
+  // already passed expires straight away, counting the missed intervals
   RETURN_CODE resume() noexcept;
   [[nodiscard]] RETURN_CODE
-  start(const std::chrono::milliseconds &duration) noexcept;
+  start(const std::chrono::nanoseconds &duration,
+        Mode mode = Mode::PERIODIC) noexcept;
+  // Expires at an absolute CLOCK_MONOTONIC deadline, then every interval if
+  // one is given
+  [[nodiscard]] RETURN_CODE
+  startAt(const std::chrono::steady_clock::time_point &deadline,
+          const std::chrono::nanoseconds &interval =
+              std::chrono::nanoseconds::zero()) noexcept;
 
   void setCallback(std::function<void(void)> callback);
+  // Replaces the callback with one that is told how many expirations it
+  // covers, more than 1 when ticks were missed
+  void setExpiryCallback(EXPIRY_CALLBACK callback);
 
   [[nodiscard]] bool isRunning() const noexcept;
+  [[nodiscard]] Mode getMode() const noexcept;
 
 private:
+  RETURN_CODE arm(const timespec &value, const timespec &interval,
+                  int flags) noexcept;
+
   void readyRead() override;
   void readyError() override;
 };
@@ -0,0 +1,118 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "transport-cpp.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace Context {
+class Engine;
+class WheelTimer;
+
+// Hierarchical timing wheel driving the timers of one Engine. Four levels of
+// 256 slots at 1 ms ticks cover ~49 days; longer timers are clamped. Timers
+// link themselves into the slots so starting and stopping one is O(1)
+class TRANSPORT_CPP_EXPORT TimerWheel {
+  friend class WheelTimer;
+
+public:
+  using TICK = std::chrono::milliseconds;
+
+private:
+  struct Link {
+    Link *prev = nullptr;
+    Link *next = nullptr;
+  };
+
+  static constexpr unsigned SLOT_BITS = 8;
+  static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+  static constexpr unsigned LEVELS = 4;
+  static constexpr unsigned WORD_BITS = 64;
+
+  using BITMAP = std::array<uint64_t, SLOTS / WORD_BITS>;
+
+  struct Level {
+    std::array<Link, SLOTS> slots;
+    BITMAP occupied = {};
+  };
+
+  std::array<Level, LEVELS> mLevels;
+  std::chrono::steady_clock::time_point mEpoch;
+  uint64_t mCurrent = 0;
+  size_t mCount = 0;
+
+public:
+  TimerWheel();
+  ~TimerWheel();
+
+  TimerWheel(const TimerWheel &) = delete;
+  TimerWheel &operator=(const TimerWheel &) = delete;
+
+  [[nodiscard]] size_t size() const noexcept;
+
+  // Shortens timeout_ms (negative waits forever) so a wait wakes up in time
+  // for the next expiry
+  [[nodiscard]] int timeoutUpto(int timeout_ms) const noexcept;
+
+  // Fires every timer that has come due
+  void advance();
+
+private:
+  [[nodiscard]] uint64_t now() const noexcept;
+  [[nodiscard]] uint64_t expiryAfter(const TICK &duration) const noexcept;
+  [[nodiscard]] uint64_t nextExpiry() const noexcept;
+
+  void schedule(WheelTimer &timer) noexcept;
+  void unschedule(WheelTimer &timer) noexcept;
+  void cascade(unsigned level);
+  void expire(Link &slot);
+
+  static void append(Link &head, Link &node) noexcept;
+  static void unlink(Link &node) noexcept;
+  static int nextOccupied(const BITMAP &occupied, unsigned from) noexcept;
+};
+
+// Timer driven by an Engine's wheel rather than a handle of its own, for
+// when many (e.g. per-connection) timers are needed. Must be used from the
+// engine's thread and must not outlive the engine
+class TRANSPORT_CPP_EXPORT WheelTimer : private TimerWheel::Link {
+  friend class TimerWheel;
+
+public:
+  enum class Mode { ONE_SHOT, PERIODIC };
+
+private:
+  static constexpr uint16_t NO_SLOT = UINT16_MAX;
+
+  TimerWheel *mWheel;
+  uint64_t mExpiry = 0;
+  TimerWheel::TICK mDuration = TimerWheel::TICK::max();
+  Mode mMode = Mode::ONE_SHOT;
+  uint16_t mSlot = NO_SLOT;
+  bool mIsRunning = false;
+  std::function<void(void)> mCallback;
+
+public:
+  explicit WheelTimer(Engine &engine) noexcept;
+  ~WheelTimer();
+
+  WheelTimer(const WheelTimer &) = delete;
+  WheelTimer &operator=(const WheelTimer &) = delete;
+
+  [[nodiscard]] RETURN_CODE start(const std::chrono::milliseconds &duration,
+                                  Mode mode = Mode::ONE_SHOT) noexcept;
+  // Starts again from now with the last duration and mode
+  [[nodiscard]] RETURN_CODE restart() noexcept;
+  RETURN_CODE stop() noexcept;
+
+  void setCallback(std::function<void(void)> callback);
+
+  [[nodiscard]] bool isRunning() const noexcept;
+};
+
+} // namespace Context
+
+#endif // TIMERWHEEL_H
@@ -19,6 +19,9 @@ static constexpr RETURN_CODE NOK = 1;
 static constexpr RETURN_CODE PASSABLE = 2;
 // Passable means failure, but should be ok to continue.
 // e.g., double registering the same device. The command failed, but its fine.
+static constexpr RETURN_CODE FULL = 3;
+// Full means an asynchronous send queue is at its limit and the message was
+// not queued.
 } // namespace RETURN
 
 namespace Transport {
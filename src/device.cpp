@@ -21,6 +21,8 @@ void Context::Device::loadEngine(ENGINE_PTR engine) {
   logDebug("Device::loadEngine", "Loading new engine");
 
   mLoadedEngine = engine;
+
+  engineChanged(engine);
 }
 
 void Context::Device::deloadEngine() {
@@ -30,12 +32,16 @@ void Context::Device::deloadEngine() {
   mLoadedEngine = nullptr;
 
   if (currentEngine != nullptr) {
+    engineChanged(nullptr);
+
     logDebug("Device::deloadEngine",
              "Engine is valid, calling deregister device");
     currentEngine->deRegisterDevice(this);
   }
 }
 
+void Device::engineChanged(ENGINE_PTR) {}
+
 void Device::readyRead() {
   logDebug("Device::readyRead",
            "Device is ready to perform a read, but functionality has not been "
@@ -92,6 +98,9 @@ std::string Device::errCodeToString(const ERROR_CODE &err_code) noexcept {
   case ERROR_CODE::TIMEOUT:
     err_str = "TIMEOUT";
     break;
+  case ERROR_CODE::QUEUE_FULL:
+    err_str = "QUEUE_FULL";
+    break;
   case ERROR_CODE::GENERAL_ERROR:
     err_str = "GENERAL_ERROR";
     break;
@@ -3,17 +3,75 @@
 #include <transport-cpp/device.h>
 
 #include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
-static constexpr int MAX_ARRAY_SIZE = 256;
+static constexpr int MAX_EPOLL_EVENTS = 256;
 
 namespace Context {
+
+// eventfd registered directly with the backend (it is not counted as a
+// registered device) so other threads can interrupt a blocked await
+class Engine::Waker final : public Device {
+private:
+  Engine &mEngine;
+
+public:
+  explicit Waker(Engine &engine) : Device(), mEngine(engine) {
+    auto handle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (handle < 0) {
+      throw std::runtime_error(std::string("Unable to create eventfd err: ") +
+                               strerror(errno));
+    }
+
+    registerNewHandle(handle);
+  }
+
+  ~Waker() override { closeHandle(); }
+
+  void signal() const noexcept {
+    const uint64_t wake = 1;
+
+    // only fails when the counter would overflow, which still leaves the
+    // engine signalled
+    [[maybe_unused]] auto res =
+        write(getDeviceHandle().value(), &wake, sizeof(wake));
+  }
+
+private:
+  void readyRead() override {
+    uint64_t count;
+
+    [[maybe_unused]] auto res =
+        read(getDeviceHandle().value(), &count, sizeof(count));
+
+    mEngine.runPostedTasks();
+  }
+};
+
 Engine::~Engine() {
-  for (auto &device : mDeviceList) {
-    deRegisterDevice(device);
+  while (!mDeviceList.empty()) {
+    deRegisterDevice(*mDeviceList.begin());
+  }
+
+  if (mWaker) {
+    deRegisterHandle(mWaker->getDeviceHandle());
+  }
+
+  if (mEpollHandle) {
+    close(mEpollHandle.value());
   }
 }
 
-Engine::Engine() = default;
+Engine::Engine() : Engine(Backend::AUTO) {}
+
+Engine::Engine(Backend backend) {
+  mBackend = initialiseBackend(backend);
+  initialiseWaker();
+}
 
 RETURN_CODE
 Context::Engine::registerDevice(std::shared_ptr<Device> device) noexcept {
@@ -47,8 +105,59 @@ RETURN_CODE Engine::deRegisterDevice(Device &device) noexcept {
 
 void Engine::setLogger(const LOGGER &logger) noexcept { mLogger = logger; }
 
+void Engine::setDeregistrationObserver(const DEVICE_OBSERVER &observer) {
+  mDeregistrationObserver = observer;
+}
+
 Engine::ERROR Engine::getLastError() const noexcept { return mLastError; }
 
+Engine::Backend Engine::getBackend() const noexcept { return mBackend; }
+
+size_t Engine::registeredDeviceCount() const noexcept {
+  return mDeviceCount.load(std::memory_order_relaxed);
+}
+
+RETURN_CODE Engine::post(TASK task) {
+  if (!task) {
+    logError("Engine/post", "An empty task was provided");
+    return RETURN::NOK;
+  }
+
+  if (!mWaker) {
+    logError("Engine/post", "Engine has no wakeup handle, unable to post");
+    return RETURN::NOK;
+  }
+
+  mTasks.push(std::move(task));
+  wake();
+
+  return RETURN::OK;
+}
+
+void Engine::wake() noexcept {
+  // one signal is enough until the engine thread has drained the queue
+  if (mWaker && !mWakePending.exchange(true, std::memory_order_acq_rel)) {
+    mWaker->signal();
+  }
+}
+
+void Engine::stop() noexcept {
+  mStopRequested.store(true, std::memory_order_release);
+  wake();
+}
+
+void Engine::setSpinBudget(const std::chrono::microseconds &budget) noexcept {
+  mSpinBudget = std::max(budget, std::chrono::microseconds::zero());
+}
+
+std::chrono::microseconds Engine::getSpinBudget() const noexcept {
+  return mSpinBudget;
+}
+
+Engine::Stats Engine::getStats() const noexcept { return mStats; }
+
+void Engine::resetStats() noexcept { mStats = Stats(); }
+
 void Engine::awaitOnce(
     const std::optional<std::chrono::milliseconds> &optional_duration) {
   int timeout = -1;
@@ -73,14 +182,14 @@ void Engine::awaitOnce(
 }
 
 void Engine::awaitFor(const std::chrono::milliseconds &duration) {
-  auto start = std::chrono::steady_clock::now();
-  auto elapsed = std::chrono::steady_clock::now() - start;
+  const auto deadline = std::chrono::steady_clock::now() + duration;
+  auto now = std::chrono::steady_clock::now();
 
-  while (elapsed < duration) {
-    auto remaining = duration - elapsed;
+  while (now < deadline &&
+         !mStopRequested.exchange(false, std::memory_order_acq_rel)) {
+    // round up so the final sub-millisecond remainder does not spin
     auto remaining_ms =
-        std::chrono::duration_cast<std::chrono::milliseconds>(remaining)
-            .count();
+        std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
 
     if (remaining_ms > std::numeric_limits<int>::max()) {
       remaining_ms = std::numeric_limits<int>::max();
@@ -88,114 +197,321 @@ void Engine::awaitFor(const std::chrono::milliseconds &duration) {
 
     awaitOnceUpto(static_cast<int>(remaining_ms));
 
-    elapsed = std::chrono::steady_clock::now() - start;
+    now = std::chrono::steady_clock::now();
   }
 }
 
-[[noreturn]] void Engine::awaitForever() {
-  while (true) {
-    awaitOnceUpto(std::chrono::milliseconds(100).count());
+void Engine::awaitForever() {
+  while (!mStopRequested.exchange(false, std::memory_order_acq_rel)) {
+    awaitOnceUpto(-1);
   }
 }
 
 bool Engine::awaitOnceUpto(int ms) {
-  auto res = poll(mPollDevices.data(), mPollDevices.size(), ms);
-  int count = 0;
+  mReadyDevices.clear();
 
-  if (res <= 0) {
+  // wake up in time for the next wheel timer
+  auto timeout = mTimerWheel.timeoutUpto(ms);
+
+  bool has_events = false;
+
+  if (mSpinBudget.count() > 0 && timeout != 0) {
+    has_events = spinWait(timeout);
+  }
+
+  if (!has_events) {
+    has_events = backendWait(timeout);
+  }
+
+  mStats.waits++;
+
+  if (has_events) {
+    mStats.wakeups++;
+
+    dispatchReady();
+  } else if (timeout < 0) {
+    mStats.spurious_wakeups++;
+  } else {
+    mStats.timeouts++;
+  }
+
+  mTimerWheel.advance();
+
+  return has_events;
+}
+
+bool Engine::backendWait(int ms) {
+  switch (mBackend) {
+  case Backend::EPOLL:
+    return epollReady(ms);
+  default:
+    return pollReady(ms);
+  }
+}
+
+bool Engine::spinWait(int &ms) {
+  const auto start = std::chrono::steady_clock::now();
+  auto budget = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      mSpinBudget);
+
+  if (ms > 0) {
+    budget = std::min<std::chrono::nanoseconds>(
+        budget, std::chrono::milliseconds(ms));
+  }
+
+  mStats.spin_loops++;
+
+  auto elapsed = std::chrono::steady_clock::duration::zero();
+
+  do {
+    mStats.spin_polls++;
+
+    if (backendWait(0)) {
+      mStats.spin_hits++;
+      return true;
+    }
+
+    elapsed = std::chrono::steady_clock::now() - start;
+  } while (elapsed < budget);
+
+  // whatever is left of the timeout is spent blocked
+  if (ms > 0) {
+    const auto spent =
+        std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    ms = std::max(0, ms - static_cast<int>(spent));
+  }
+
+  return false;
+}
+
+Engine::Backend Engine::initialiseBackend(Backend backend) {
+  if (backend == Backend::POLL) {
+    return Backend::POLL;
+  }
+
+  if (initialiseEpoll()) {
+    return Backend::EPOLL;
+  }
+
+  if (backend == Backend::EPOLL) {
+    logWarn("Engine", "epoll was requested but could not be initialised. "
+                      "Falling back to poll");
+  }
+
+  return Backend::POLL;
+}
+
+bool Engine::initialiseEpoll() {
+  auto handle = epoll_create1(EPOLL_CLOEXEC);
+
+  if (handle == -1) {
+    setError(ERROR_CODE::BACKEND_ERROR,
+             std::string("Unable to create epoll instance: ") +
+                 strerror(errno));
     return false;
   }
 
-  static thread_local std::vector<DEVICE_HANDLE_> ready_read(MAX_ARRAY_SIZE);
-  static thread_local std::vector<DEVICE_HANDLE_> ready_write(MAX_ARRAY_SIZE);
-  static thread_local std::vector<DEVICE_HANDLE_> error(MAX_ARRAY_SIZE);
-  static thread_local std::vector<DEVICE_HANDLE_> hangup(MAX_ARRAY_SIZE);
-  static thread_local std::vector<DEVICE_HANDLE_> invalid(MAX_ARRAY_SIZE);
-  static thread_local std::vector<DEVICE_HANDLE_> peer_disconnect(
-      MAX_ARRAY_SIZE);
+  mEpollHandle = handle;
+  mEpollEvents.resize(MAX_EPOLL_EVENTS);
+
+  return true;
+}
 
-  ready_read.clear();
-  ready_write.clear();
-  error.clear();
-  hangup.clear();
-  invalid.clear();
-  peer_disconnect.clear();
+bool Engine::pollReady(int ms) {
+  auto res = poll(mPollDevices.data(), mPollDevices.size(), ms);
 
-  //    ready_read.reserve(static_cast<size_t>(res));
-  //    ready_write.reserve(static_cast<size_t>(res));
-  //    error.reserve(static_cast<size_t>(res));
+  if (res <= 0) {
+    return false;
+  }
+
+  int found = 0;
 
   for (const auto &fd : mPollDevices) {
-    if (fd.revents == POLLIN) {
-      ready_read.push_back(fd.fd);
-      count++;
-    } else if (fd.revents == POLLOUT) {
-      ready_write.push_back(fd.fd);
-      count++;
-    } else if (fd.revents & POLLERR) {
-      error.push_back(fd.fd);
-      count++;
-    } else if (fd.revents & POLLHUP) {
-      hangup.push_back(fd.fd);
-      count++;
-    } else if (fd.revents & POLLNVAL) {
-      invalid.push_back(fd.fd);
-      count++;
-    } else if (fd.revents & POLLRDHUP) {
-      peer_disconnect.push_back(fd.fd);
-      count++;
+    if (fd.revents == 0) {
+      continue;
     }
 
-    if (count >= res) {
+    addReady(fd);
+
+    if (++found >= res) {
       break;
     }
   }
 
-  for (const auto &poll_in : ready_read) {
-    if (mDeviceMapping.find(poll_in) != mDeviceMapping.end()) {
-      mDeviceMapping[poll_in]->readyRead();
-    }
+  return true;
+}
+
+bool Engine::epollReady(int ms) {
+  auto res = epoll_wait(mEpollHandle.value(), mEpollEvents.data(),
+                        static_cast<int>(mEpollEvents.size()), ms);
+
+  if (res <= 0) {
+    return false;
   }
 
-  for (const auto &poll_out : ready_write) {
-    if (mDeviceMapping.find(poll_out) != mDeviceMapping.end()) {
-      mDeviceMapping[poll_out]->readyWrite();
+  for (int x = 0; x < res; x++) {
+    const auto &event = mEpollEvents[static_cast<size_t>(x)];
+
+    pollfd fd;
+    fd.fd = event.data.fd;
+    fd.events = 0;
+    fd.revents = 0;
+
+    if (event.events & EPOLLIN) {
+      fd.revents |= POLLIN;
     }
-  }
 
-  for (const auto &poll_err : error) {
-    if (mDeviceMapping.find(poll_err) != mDeviceMapping.end()) {
-      mDeviceMapping[poll_err]->readyError();
+    if (event.events & EPOLLOUT) {
+      fd.revents |= POLLOUT;
     }
-  }
 
-  for (const auto &hangup : hangup) {
-    if (mDeviceMapping.find(hangup) != mDeviceMapping.end()) {
-      mDeviceMapping[hangup]->readyHangup();
+    if (event.events & EPOLLERR) {
+      fd.revents |= POLLERR;
     }
-  }
 
-  for (const auto &inval : invalid) {
-    if (mDeviceMapping.find(inval) != mDeviceMapping.end()) {
-      mDeviceMapping[inval]->readyInvalidRequest();
+    if (event.events & EPOLLHUP) {
+      fd.revents |= POLLHUP;
     }
-  }
 
-  for (const auto &disc : peer_disconnect) {
-    if (mDeviceMapping.find(disc) != mDeviceMapping.end()) {
-      mDeviceMapping[disc]->readyPeerDisconnect();
+    if (event.events & EPOLLRDHUP) {
+      fd.revents |= POLLRDHUP;
     }
+
+    addReady(fd);
+  }
+
+  // every slot was filled, there may be more ready than we can take at once
+  if (static_cast<size_t>(res) == mEpollEvents.size()) {
+    mEpollEvents.resize(mEpollEvents.size() * 2);
   }
 
   return true;
 }
 
+void Engine::backendAdd(const POLL_STRUCT &fd) {
+  if (mBackend != Backend::EPOLL) {
+    return;
+  }
+
+  epoll_event event = {};
+  event.events = static_cast<uint32_t>(fd.events);
+  event.data.fd = fd.fd;
+
+  if (epoll_ctl(mEpollHandle.value(), EPOLL_CTL_ADD, fd.fd, &event) == -1) {
+    logError("Engine/backendAdd", "Unable to add handle to epoll: " +
+                                      std::string(strerror(errno)));
+  }
+}
+
+void Engine::backendModify(const POLL_STRUCT &fd) {
+  if (mBackend != Backend::EPOLL) {
+    return;
+  }
+
+  epoll_event event = {};
+  event.events = static_cast<uint32_t>(fd.events);
+  event.data.fd = fd.fd;
+
+  if (epoll_ctl(mEpollHandle.value(), EPOLL_CTL_MOD, fd.fd, &event) == -1) {
+    logError("Engine/backendModify", "Unable to modify epoll interest: " +
+                                         std::string(strerror(errno)));
+  }
+}
+
+void Engine::backendRemove(DEVICE_HANDLE_ handle) {
+  if (mBackend != Backend::EPOLL) {
+    return;
+  }
+
+  // the handle has usually been closed already, which removes it from the
+  // epoll set on its own. EBADF/ENOENT are expected here
+  epoll_ctl(mEpollHandle.value(), EPOLL_CTL_DEL, handle, nullptr);
+}
+
+void Engine::addReady(const POLL_STRUCT &fd) {
+  const auto slot = findSlot(fd.fd);
+
+  if (slot != nullptr) {
+    mReadyDevices.push_back({fd, slot->generation});
+  }
+}
+
+void Engine::dispatchReady() {
+  struct Handler {
+    short mask;
+    void (Device::*callback)();
+  };
+
+  // data is read before a hangup or error is acted upon, so nothing still
+  // buffered is lost
+  static constexpr Handler HANDLERS[] = {
+      {POLLIN, &Device::readyRead},
+      {POLLOUT, &Device::readyWrite},
+      {POLLRDHUP, &Device::readyPeerDisconnect},
+      {POLLHUP, &Device::readyHangup},
+      {POLLERR, &Device::readyError},
+      {POLLNVAL, &Device::readyInvalidRequest}};
+
+  for (const auto &ready : mReadyDevices) {
+    const auto &fd = ready.fd;
+    auto slot = findSlot(fd.fd);
+
+    // an earlier callback closed the handle, which may already belong to a
+    // new device; the events were the old socket's
+    if (slot == nullptr || slot->generation != ready.generation) {
+      continue;
+    }
+
+    const auto device = slot->device;
+
+    for (const auto &handler : HANDLERS) {
+      if ((fd.revents & handler.mask) == 0) {
+        continue;
+      }
+
+      (device->*handler.callback)();
+
+      // the callback may have deregistered, or even destroyed, the device.
+      // Its remaining events are stale once the slot has moved on
+      slot = findSlot(fd.fd);
+
+      if (slot == nullptr || slot->device != device ||
+          slot->generation != ready.generation) {
+        break;
+      }
+    }
+  }
+}
+
+void Engine::initialiseWaker() {
+  try {
+    mWaker = std::make_unique<Waker>(*this);
+  } catch (const std::runtime_error &err) {
+    logError("Engine", std::string(err.what()) +
+                           ". Tasks can not be posted to this engine");
+    return;
+  }
+
+  registerNewHandle({}, mWaker->getDeviceHandle(), mWaker.get());
+}
+
+void Engine::runPostedTasks() {
+  // clearing first means a task posted from here on signals again. The
+  // exchange also pairs with the producer's so its task is visible below
+  mWakePending.exchange(false, std::memory_order_acq_rel);
+
+  TASK task;
+
+  while (mTasks.pop(task)) {
+    mStats.tasks_run++;
+    task();
+  }
+}
+
 RETURN_CODE Engine::registerDevice(Device *device) {
   logDebug("Engine", "Registering device");
 
-  auto device_item = std::find(mDeviceList.begin(), mDeviceList.end(), device);
-
-  if (device_item != mDeviceList.end()) {
+  if (mDeviceList.find(device) != mDeviceList.end()) {
     setError(ERROR_CODE::DEVICE_ALREADY_REGISTERED, "");
     return RETURN::PASSABLE;
   }
@@ -206,7 +522,8 @@ RETURN_CODE Engine::registerDevice(Device *device) {
 
   device->loadEngine(this);
 
-  mDeviceList.push_back(device);
+  mDeviceList.insert(device);
+  mDeviceCount.store(mDeviceList.size(), std::memory_order_relaxed);
 
   auto handle = device->getDeviceHandle();
 
@@ -224,10 +541,12 @@ RETURN_CODE Engine::deRegisterDevice(Device *device) {
 
   deRegisterHandle(device->getDeviceHandle());
 
-  auto device_item = std::find(mDeviceList.begin(), mDeviceList.end(), device);
+  // deloadEngine comes back through here, only the first pass erases
+  const bool was_registered = mDeviceList.erase(device) != 0;
+  mDeviceCount.store(mDeviceList.size(), std::memory_order_relaxed);
 
-  if (device_item != mDeviceList.end()) {
-    mDeviceList.erase(device_item);
+  if (was_registered && mDeregistrationObserver) {
+    mDeregistrationObserver(device);
   }
 
   return RETURN::OK;
@@ -242,25 +561,57 @@ RETURN_CODE Engine::registerNewHandle(DEVICE_HANDLE old_handle,
     return RETURN::PASSABLE;
   }
 
-  auto handle_pos = findHandleInList(old_handle);
+  const auto handle = new_handle.value();
+
+  if (handle < 0) {
+    setError(ERROR_CODE::INVALID_ARGUMENT,
+             "When registering a new handle, a negative handle was provided");
+    return RETURN::NOK;
+  }
+
+  if (findSlot(new_handle) != nullptr) {
+    // a stale registration was left behind for a closed and reused handle
+    deRegisterHandle(new_handle);
+  }
+
+  const auto index = static_cast<size_t>(handle);
+
+  if (index >= mDeviceTable.size()) {
+    mDeviceTable.resize(index + 1);
+  }
 
-  if (handle_pos == mPollDevices.end()) {
+  auto old_slot = findSlot(old_handle);
+
+  if (old_slot == nullptr) {
     pollfd fd;
-    fd.fd = new_handle.value();
+    fd.fd = handle;
     fd.events = POLLIN;
+    fd.revents = 0;
+
+    auto &slot = mDeviceTable[index];
+    slot.device = relevant_device;
+    slot.poll_index = mPollDevices.size();
+    slot.events = fd.events;
 
     mPollDevices.push_back(fd);
-    mDeviceMapping.insert({fd.fd, relevant_device});
+    backendAdd(fd);
 
     return RETURN::OK;
   }
 
-  if (old_handle) {
-    mDeviceMapping.erase(old_handle.value());
-  }
+  auto &fd = mPollDevices[old_slot->poll_index];
+
+  backendRemove(fd.fd);
+
+  auto &slot = mDeviceTable[index];
+  slot.device = relevant_device;
+  slot.poll_index = old_slot->poll_index;
+  slot.events = old_slot->events;
+
+  releaseSlot(*old_slot);
 
-  mDeviceMapping.insert({new_handle.value(), relevant_device});
-  (*handle_pos).fd = new_handle.value();
+  fd.fd = handle;
+  backendAdd(fd);
 
   return RETURN::OK;
 }
@@ -272,31 +623,52 @@ RETURN_CODE Engine::deRegisterHandle(DEVICE_HANDLE handle) {
     return RETURN::PASSABLE;
   }
 
-  auto handle_pos = findHandleInList(handle);
+  auto slot = findSlot(handle);
 
-  if (handle_pos == mPollDevices.end()) {
+  if (slot == nullptr) {
     setError(ERROR_CODE::DEVICE_DOES_NOT_EXIST,
              "When deregistering the handle, "
              "the device handle was not found in the registered list");
     return RETURN::NOK;
   }
 
-  mPollDevices.erase(handle_pos);
-  mDeviceMapping.erase(handle.value());
+  backendRemove(handle.value());
+
+  const auto index = slot->poll_index;
+  const auto &last = mPollDevices.back();
+
+  if (index != mPollDevices.size() - 1) {
+    mDeviceTable[static_cast<size_t>(last.fd)].poll_index = index;
+    mPollDevices[index] = last;
+  }
+
+  mPollDevices.pop_back();
+  releaseSlot(*slot);
+
   return RETURN::OK;
 }
 
-Engine::POLL_LIST::iterator Engine::findHandleInList(DEVICE_HANDLE handle) {
-  if (!handle.has_value()) {
-    return mPollDevices.end();
+void Engine::releaseSlot(DeviceSlot &slot) noexcept {
+  // the generation outlives the registration so ready events still queued
+  // for a reused handle can be told apart
+  slot.device = nullptr;
+  slot.poll_index = 0;
+  slot.events = 0;
+  slot.generation++;
+}
+
+Engine::DeviceSlot *Engine::findSlot(const DEVICE_HANDLE &handle) noexcept {
+  if (!handle.has_value() || handle.value() < 0) {
+    return nullptr;
   }
 
-  std::vector<int> x;
+  const auto index = static_cast<size_t>(handle.value());
+
+  if (index >= mDeviceTable.size() || mDeviceTable[index].device == nullptr) {
+    return nullptr;
+  }
 
-  return std::find_if(mPollDevices.begin(), mPollDevices.end(),
-                      [&handle](const decltype(mPollDevices)::value_type &fd) {
-                        return fd.fd == handle.value();
-                      });
+  return &mDeviceTable[index];
 }
 
 void Engine::setError(ERROR_CODE code, const ERROR_STRING &description) {
@@ -341,23 +713,27 @@ void Engine::logFatal(const std::string &calling_class,
 }
 
 void Engine::requestRead(const DEVICE_HANDLE &handle) {
-  auto pollfd_it = findHandleInList(handle);
-
-  if (pollfd_it == mPollDevices.end()) {
-    return;
-  }
-
-  pollfd_it->events = POLLIN;
+  requestEvents(handle, POLLIN);
 }
 
 void Engine::requestWrite(const DEVICE_HANDLE &handle) {
-  auto pollfd_it = findHandleInList(handle);
+  // keep reading while a write is pending so full duplex traffic is not
+  // stalled behind the outgoing queue
+  requestEvents(handle, POLLIN | POLLOUT);
+}
 
-  if (pollfd_it == mPollDevices.end()) {
+void Engine::requestEvents(const DEVICE_HANDLE &handle, short events) {
+  auto slot = findSlot(handle);
+
+  if (slot == nullptr || slot->events == events) {
     return;
   }
 
-  pollfd_it->events = POLLOUT;
+  auto &fd = mPollDevices[slot->poll_index];
+
+  slot->events = events;
+  fd.events = events;
+  backendModify(fd);
 }
 
 } // namespace Context
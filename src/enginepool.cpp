@@ -0,0 +1,292 @@
+#include <transport-cpp/enginepool.h>
+
+#include <cstring>
+#include <optional>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+
+namespace Context {
+
+EnginePool::EnginePool(size_t thread_count, Engine::Backend backend,
+                       bool pin_threads)
+    : mPinThreads(pin_threads) {
+  if (thread_count == 0) {
+    thread_count = 1;
+  }
+
+  for (size_t x = 0; x < thread_count; x++) {
+    auto worker = std::make_unique<Worker>();
+
+    worker->engine = std::make_unique<Engine>(backend);
+    worker->engine->setDeregistrationObserver(
+        [this, x](const Device *device) { forgetPlacement(device, x); });
+    mWorkers.push_back(std::move(worker));
+  }
+}
+
+EnginePool::~EnginePool() {
+  stop();
+
+  // engines deregister their devices as they go, which needs mPlacements
+  mWorkers.clear();
+}
+
+void EnginePool::start() {
+  if (mStarted) {
+    return;
+  }
+
+  mStarted = true;
+
+  for (size_t x = 0; x < mWorkers.size(); x++) {
+    auto &worker = *mWorkers[x];
+
+    worker.thread =
+        std::thread(&EnginePool::run, this, std::ref(*worker.engine), x);
+  }
+}
+
+void EnginePool::stop() {
+  if (!mStarted) {
+    return;
+  }
+
+  for (auto &worker : mWorkers) {
+    worker->engine->stop();
+  }
+
+  for (auto &worker : mWorkers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+
+  mStarted = false;
+}
+
+void EnginePool::setLogger(const LOGGER &logger) noexcept { mLogger = logger; }
+
+size_t EnginePool::size() const noexcept { return mWorkers.size(); }
+
+bool EnginePool::isRunning() const noexcept { return mStarted; }
+
+Engine &EnginePool::engine(size_t index) {
+  if (index >= mWorkers.size()) {
+    throw std::out_of_range("EnginePool engine index out of range");
+  }
+
+  return *mWorkers[index]->engine;
+}
+
+size_t EnginePool::selectEngine(Placement placement) noexcept {
+  if (placement == Placement::LEAST_LOADED) {
+    // registrations still queued for an engine count towards its load
+    const auto load = [](const Worker &worker) {
+      return worker.engine->registeredDeviceCount() + worker.pending.load();
+    };
+
+    size_t selected = 0;
+    auto lowest = load(*mWorkers[0]);
+
+    for (size_t x = 1; x < mWorkers.size(); x++) {
+      const auto count = load(*mWorkers[x]);
+
+      if (count < lowest) {
+        lowest = count;
+        selected = x;
+      }
+    }
+
+    return selected;
+  }
+
+  return mNextWorker.fetch_add(1, std::memory_order_relaxed) %
+         mWorkers.size();
+}
+
+RETURN_CODE EnginePool::registerDevice(Device &device, Placement placement) {
+  return registerDevice(device, selectEngine(placement));
+}
+
+RETURN_CODE EnginePool::registerDevice(Device &device, size_t index) {
+  if (index >= mWorkers.size()) {
+    logError("EnginePool/registerDevice", "Engine index out of range");
+    return RETURN::NOK;
+  }
+
+  auto worker_ptr = mWorkers[index].get();
+  auto engine_ptr = worker_ptr->engine.get();
+  auto device_ptr = &device;
+  std::optional<size_t> previous;
+
+  {
+    std::lock_guard<std::mutex> lock(mPlacementLock);
+
+    // the old engine can only be told apart once the device has arrived
+    if (mMoving.count(device_ptr) != 0) {
+      logError("EnginePool/registerDevice",
+               "Device is still being moved to another engine");
+      return RETURN::NOK;
+    }
+
+    auto placement = mPlacements.find(device_ptr);
+
+    if (placement != mPlacements.end() && placement->second != index) {
+      previous = placement->second;
+      mMoving.insert(device_ptr);
+    }
+
+    mPlacements[device_ptr] = index;
+  }
+
+  worker_ptr->pending++;
+
+  auto registration = [this, worker_ptr, engine_ptr, device_ptr] {
+    worker_ptr->pending--;
+
+    if (engine_ptr->registerDevice(*device_ptr) == RETURN::NOK) {
+      logError("EnginePool/registerDevice",
+               "Engine rejected device: " +
+                   engine_ptr->getLastError().description);
+    }
+  };
+
+  if (!previous) {
+    return post(index, std::move(registration));
+  }
+
+  // the old engine has to let go of the device on its own thread before the
+  // new one takes it
+  auto old_engine = mWorkers[previous.value()]->engine.get();
+
+  auto arrival = [this, device_ptr, registration] {
+    registration();
+    finishMove(device_ptr);
+  };
+
+  const auto ret = post(previous.value(), [this, old_engine, device_ptr,
+                                           worker_ptr, index, arrival] {
+    (void)old_engine->deRegisterDevice(*device_ptr);
+
+    if (post(index, arrival) == RETURN::NOK) {
+      worker_ptr->pending--;
+      finishMove(device_ptr);
+    }
+  });
+
+  if (ret == RETURN::NOK) {
+    worker_ptr->pending--;
+    finishMove(device_ptr);
+  }
+
+  return ret;
+}
+
+RETURN_CODE EnginePool::post(size_t index, TASK task) {
+  if (index >= mWorkers.size()) {
+    logError("EnginePool/post", "Engine index out of range");
+    return RETURN::NOK;
+  }
+
+  if (!task) {
+    logError("EnginePool/post", "An empty task was provided");
+    return RETURN::NOK;
+  }
+
+  return mWorkers[index]->engine->post(std::move(task));
+}
+
+RETURN_CODE EnginePool::post(const Device &device, TASK task) {
+  size_t index;
+
+  {
+    std::lock_guard<std::mutex> lock(mPlacementLock);
+
+    auto placement = mPlacements.find(&device);
+
+    if (placement == mPlacements.end()) {
+      logError("EnginePool/post",
+               "Device was not placed into the pool, unable to find its "
+               "engine");
+      return RETURN::NOK;
+    }
+
+    index = placement->second;
+  }
+
+  return post(index, std::move(task));
+}
+
+RETURN_CODE EnginePool::asyncSend(Devices::IO::IODevice &device,
+                                  IODATA data) {
+  auto device_ptr = &device;
+  auto message = std::make_shared<IODATA>(std::move(data));
+
+  return post(device, [this, device_ptr, message] {
+    if (device_ptr->asyncSend(message) != RETURN::OK) {
+      logError("EnginePool/asyncSend",
+               "Queued send failed: " + device_ptr->getLastError().description);
+    }
+  });
+}
+
+void EnginePool::finishMove(const Device *device) {
+  std::lock_guard<std::mutex> lock(mPlacementLock);
+  mMoving.erase(device);
+}
+
+void EnginePool::forgetPlacement(const Device *device, size_t index) {
+  std::lock_guard<std::mutex> lock(mPlacementLock);
+
+  // a device moved to another engine already has its new placement
+  const auto placement = mPlacements.find(device);
+
+  if (placement != mPlacements.end() && placement->second == index) {
+    mPlacements.erase(placement);
+  }
+}
+
+void EnginePool::run(Engine &engine, size_t index) {
+  if (mPinThreads) {
+    pinThread(index);
+  }
+
+  engine.awaitForever();
+}
+
+void EnginePool::pinThread(size_t index) {
+  const auto cpus = std::thread::hardware_concurrency();
+
+  if (cpus == 0) {
+    return;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(index % cpus, &set);
+
+  if (const auto res =
+          pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+      res != 0) {
+    logWarn("EnginePool/pinThread",
+            "Unable to pin engine thread " + std::to_string(index) + ": " +
+                strerror(res));
+  }
+}
+
+void EnginePool::logWarn(const std::string &calling_class,
+                         const std::string &message) const {
+  if (mLogger) {
+    mLogger->logWarn(calling_class, message);
+  }
+}
+
+void EnginePool::logError(const std::string &calling_class,
+                          const std::string &message) const {
+  if (mLogger) {
+    mLogger->logError(calling_class, message);
+  }
+}
+
+} // namespace Context
@@ -0,0 +1,366 @@
+#include <transport-cpp/framer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace Context::Devices::IO {
+
+Framer Framer::fixedLength(size_t length) {
+  Framer framer;
+
+  framer.mMode = Mode::FIXED_LENGTH;
+  framer.mLength = length;
+  framer.mMaxFrame = length;
+
+  return framer;
+}
+
+Framer Framer::lengthPrefixed(PrefixSize prefix_size, Endian endian,
+                              size_t max_frame) {
+  Framer framer;
+
+  framer.mMode = Mode::LENGTH_PREFIX;
+  framer.mPrefixSize = prefix_size;
+  framer.mEndian = endian;
+  framer.mMaxFrame = max_frame;
+
+  return framer;
+}
+
+Framer Framer::delimited(const IODATA &delimiter, size_t max_frame) {
+  Framer framer;
+
+  framer.mMode = Mode::DELIMITER;
+  framer.mDelimiter = delimiter;
+  framer.mMaxFrame = max_frame;
+
+  return framer;
+}
+
+Framer Framer::delimited(BYTE delimiter, size_t max_frame) {
+  return delimited(IODATA{delimiter}, max_frame);
+}
+
+bool Framer::isValid() const noexcept {
+  switch (mMode) {
+  case Mode::FIXED_LENGTH:
+    return mLength != 0;
+  case Mode::DELIMITER:
+    return !mDelimiter.empty();
+  case Mode::LENGTH_PREFIX:
+    return true;
+  }
+
+  return false;
+}
+
+Framer::Mode Framer::mode() const noexcept { return mMode; }
+
+size_t Framer::maxFrameSize() const noexcept { return mMaxFrame; }
+
+Framer::Status Framer::feed(const BYTE *data, size_t size,
+                            const FRAME_HANDLER &handler) {
+  size_t offset = 0;
+
+  if (!mPending.empty()) {
+    Span span;
+
+    auto status = completePending(data, size, span);
+
+    if (status != Status::OK) {
+      reset();
+      return status;
+    }
+
+    if (span.consumed == 0) {
+      // everything went into the pending frame
+      return Status::OK;
+    }
+
+    const bool carry_on = handler(mPending.data() + span.offset, span.size);
+    mPending.clear();
+
+    if (!carry_on) {
+      return Status::STOPPED;
+    }
+
+    offset = span.consumed;
+  }
+
+  while (offset < size) {
+    Span span;
+
+    auto status = nextFrame(data + offset, size - offset, span);
+
+    if (status != Status::OK) {
+      reset();
+      return status;
+    }
+
+    if (span.consumed == 0) {
+      break;
+    }
+
+    if (!handler(data + offset + span.offset, span.size)) {
+      return Status::STOPPED;
+    }
+
+    offset += span.consumed;
+  }
+
+  // only the start of a frame that is still incomplete is copied
+  mPending.assign(data + offset, data + size);
+
+  return Status::OK;
+}
+
+void Framer::reset() noexcept { mPending.clear(); }
+
+size_t Framer::pendingBytes() const noexcept { return mPending.size(); }
+
+Framer::IODATA Framer::frame(const IODATA &payload) const {
+  IODATA out;
+
+  switch (mMode) {
+  case Mode::FIXED_LENGTH:
+    if (payload.size() != mLength) {
+      return {};
+    }
+
+    return payload;
+
+  case Mode::DELIMITER:
+    out.reserve(payload.size() + mDelimiter.size());
+    out.insert(out.end(), payload.begin(), payload.end());
+    out.insert(out.end(), mDelimiter.begin(), mDelimiter.end());
+
+    return out;
+
+  case Mode::LENGTH_PREFIX: {
+    const auto prefix = prefixBytes();
+    const uint64_t limit = mPrefixSize == PrefixSize::U16
+                               ? std::numeric_limits<uint16_t>::max()
+                               : std::numeric_limits<uint32_t>::max();
+
+    if (payload.size() > limit) {
+      return {};
+    }
+
+    const auto length = static_cast<uint64_t>(payload.size());
+
+    out.resize(prefix + payload.size());
+
+    for (size_t x = 0; x < prefix; x++) {
+      const auto shift =
+          mEndian == Endian::BIG ? (prefix - 1 - x) * 8 : x * 8;
+      out[x] = static_cast<BYTE>((length >> shift) & 0xFF);
+    }
+
+    std::copy(payload.begin(), payload.end(), out.begin() + prefix);
+
+    return out;
+  }
+  }
+
+  return out;
+}
+
+Framer::Status Framer::nextFrame(const BYTE *data, size_t size,
+                                 Span &span) const noexcept {
+  switch (mMode) {
+  case Mode::FIXED_LENGTH:
+    if (size >= mLength) {
+      span = {0, mLength, mLength};
+    }
+
+    return Status::OK;
+
+  case Mode::LENGTH_PREFIX: {
+    const auto prefix = prefixBytes();
+
+    if (size < prefix) {
+      return Status::OK;
+    }
+
+    const auto length = decodeLength(data);
+
+    if (length > mMaxFrame) {
+      return Status::TOO_LARGE;
+    }
+
+    if (size - prefix >= length) {
+      span = {prefix, length, prefix + length};
+    }
+
+    return Status::OK;
+  }
+
+  case Mode::DELIMITER: {
+    const auto found = findDelimiter(data, size);
+
+    if (found == nullptr) {
+      // the tail may hold the start of the delimiter
+      if (size > mMaxFrame + mDelimiter.size() - 1) {
+        return Status::TOO_LARGE;
+      }
+
+      return Status::OK;
+    }
+
+    const auto length = static_cast<size_t>(found - data);
+
+    if (length > mMaxFrame) {
+      return Status::TOO_LARGE;
+    }
+
+    span = {0, length, length + mDelimiter.size()};
+
+    return Status::OK;
+  }
+  }
+
+  return Status::OK;
+}
+
+Framer::Status Framer::completePending(const BYTE *data, size_t size,
+                                       Span &span) {
+  if (mMode == Mode::DELIMITER) {
+    return completePendingDelimited(data, size, span);
+  }
+
+  const auto prefix = mMode == Mode::FIXED_LENGTH ? 0 : prefixBytes();
+  size_t taken = 0;
+
+  // a length prefix may itself be split, the first pass completes it
+  for (;;) {
+    const bool header_known = mPending.size() >= prefix;
+    size_t needed = mLength;
+
+    if (mMode == Mode::LENGTH_PREFIX) {
+      needed = prefix;
+
+      if (header_known) {
+        const auto length = decodeLength(mPending.data());
+
+        if (length > mMaxFrame) {
+          return Status::TOO_LARGE;
+        }
+
+        needed += length;
+      }
+    }
+
+    const auto take = std::min(needed - mPending.size(), size - taken);
+
+    mPending.insert(mPending.end(), data + taken, data + taken + take);
+    taken += take;
+
+    if (mPending.size() < needed) {
+      return Status::OK;
+    }
+
+    if (header_known) {
+      span = {prefix, needed - prefix, taken};
+      return Status::OK;
+    }
+  }
+}
+
+Framer::Status Framer::completePendingDelimited(const BYTE *data, size_t size,
+                                                Span &span) {
+  const auto delim_len = mDelimiter.size();
+  const auto pending = mPending.size();
+
+  // a delimiter starting in the pending bytes and ending in data
+  const auto first = pending > delim_len - 1 ? pending - (delim_len - 1) : 0;
+
+  for (auto start = first; start < pending; start++) {
+    const auto head = pending - start;
+    const auto tail = delim_len - head;
+
+    if (tail > size ||
+        std::memcmp(mPending.data() + start, mDelimiter.data(), head) != 0 ||
+        std::memcmp(data, mDelimiter.data() + head, tail) != 0) {
+      continue;
+    }
+
+    if (start > mMaxFrame) {
+      return Status::TOO_LARGE;
+    }
+
+    mPending.resize(start);
+    span = {0, start, tail};
+
+    return Status::OK;
+  }
+
+  const auto found = findDelimiter(data, size);
+
+  if (found == nullptr) {
+    mPending.insert(mPending.end(), data, data + size);
+
+    if (mPending.size() > mMaxFrame + delim_len - 1) {
+      return Status::TOO_LARGE;
+    }
+
+    return Status::OK;
+  }
+
+  const auto length = static_cast<size_t>(found - data);
+
+  if (pending + length > mMaxFrame) {
+    return Status::TOO_LARGE;
+  }
+
+  mPending.insert(mPending.end(), data, found);
+  span = {0, mPending.size(), length + delim_len};
+
+  return Status::OK;
+}
+
+size_t Framer::prefixBytes() const noexcept {
+  return static_cast<size_t>(mPrefixSize);
+}
+
+size_t Framer::decodeLength(const BYTE *prefix) const noexcept {
+  const auto bytes = reinterpret_cast<const uint8_t *>(prefix);
+  const auto count = prefixBytes();
+  size_t length = 0;
+
+  for (size_t x = 0; x < count; x++) {
+    const auto byte = mEndian == Endian::BIG ? bytes[x] : bytes[count - 1 - x];
+    length = (length << 8) | byte;
+  }
+
+  return length;
+}
+
+const Framer::BYTE *Framer::findDelimiter(const BYTE *data,
+                                          size_t size) const noexcept {
+  const auto delim_len = mDelimiter.size();
+  const auto end = data + size;
+  auto pos = data;
+
+  // memchr is vectorised in glibc, the rest of a longer delimiter is only
+  // compared where its first byte turns up
+  while (static_cast<size_t>(end - pos) >= delim_len) {
+    const auto remaining = static_cast<size_t>(end - pos) - delim_len + 1;
+    const auto hit = static_cast<const BYTE *>(
+        std::memchr(pos, mDelimiter.front(), remaining));
+
+    if (hit == nullptr) {
+      return nullptr;
+    }
+
+    if (std::memcmp(hit + 1, mDelimiter.data() + 1, delim_len - 1) == 0) {
+      return hit;
+    }
+
+    pos = hit + 1;
+  }
+
+  return nullptr;
+}
+
+} // namespace Context::Devices::IO
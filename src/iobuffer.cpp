@@ -0,0 +1,171 @@
+#include <transport-cpp/iobuffer.h>
+
+#include <algorithm>
+#include <new>
+
+namespace Context::Devices::IO {
+
+// Header of a single allocation, the bytes follow directly after it
+struct IOBuffer::Block {
+  std::atomic<uint32_t> refs{1};
+  size_t size = 0;
+  size_t capacity;
+  std::shared_ptr<IOBufferPool> pool;
+
+  explicit Block(size_t block_capacity) : capacity(block_capacity) {}
+
+  BYTE *bytes() noexcept { return reinterpret_cast<BYTE *>(this + 1); }
+
+  static Block *allocate(size_t capacity) {
+    auto memory = ::operator new(sizeof(Block) + capacity);
+    return new (memory) Block(capacity);
+  }
+
+  static void free(Block *block) noexcept {
+    block->~Block();
+    ::operator delete(block);
+  }
+};
+
+IOBuffer::IOBuffer(Block *block) noexcept : mBlock(block) {}
+
+IOBuffer::~IOBuffer() { reset(); }
+
+IOBuffer::IOBuffer(const IOBuffer &other) noexcept : mBlock(other.mBlock) {
+  if (mBlock != nullptr) {
+    mBlock->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+IOBuffer::IOBuffer(IOBuffer &&other) noexcept : mBlock(other.mBlock) {
+  other.mBlock = nullptr;
+}
+
+IOBuffer &IOBuffer::operator=(const IOBuffer &other) noexcept {
+  if (this != &other) {
+    IOBuffer copy(other);
+    std::swap(mBlock, copy.mBlock);
+  }
+
+  return *this;
+}
+
+IOBuffer &IOBuffer::operator=(IOBuffer &&other) noexcept {
+  if (this != &other) {
+    reset();
+    std::swap(mBlock, other.mBlock);
+  }
+
+  return *this;
+}
+
+const IOBuffer::BYTE *IOBuffer::data() const noexcept {
+  return (mBlock != nullptr) ? mBlock->bytes() : nullptr;
+}
+
+IOBuffer::BYTE *IOBuffer::data() noexcept {
+  return (mBlock != nullptr) ? mBlock->bytes() : nullptr;
+}
+
+size_t IOBuffer::size() const noexcept {
+  return (mBlock != nullptr) ? mBlock->size : 0;
+}
+
+size_t IOBuffer::capacity() const noexcept {
+  return (mBlock != nullptr) ? mBlock->capacity : 0;
+}
+
+bool IOBuffer::empty() const noexcept { return size() == 0; }
+
+const IOBuffer::BYTE *IOBuffer::begin() const noexcept { return data(); }
+
+const IOBuffer::BYTE *IOBuffer::end() const noexcept {
+  return data() + size();
+}
+
+void IOBuffer::resize(size_t size) noexcept {
+  if (mBlock != nullptr) {
+    mBlock->size = std::min(size, mBlock->capacity);
+  }
+}
+
+void IOBuffer::reset() noexcept {
+  auto block = mBlock;
+  mBlock = nullptr;
+
+  if (block == nullptr ||
+      block->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+
+  // the pool may only be kept alive by this buffer, hold on to it until
+  // the block has been handed back
+  auto pool = std::move(block->pool);
+  pool->recycle(block);
+}
+
+IOBuffer::IODATA IOBuffer::toIOData() const { return IODATA(begin(), end()); }
+
+IOBuffer::operator bool() const noexcept { return mBlock != nullptr; }
+
+IOBufferPool::IOBufferPool(size_t buffer_size, size_t max_cached)
+    : mBufferSize(std::max<size_t>(buffer_size, 1)), mMaxCached(max_cached) {
+  mFree.reserve(mMaxCached);
+}
+
+std::shared_ptr<IOBufferPool> IOBufferPool::create(size_t buffer_size,
+                                                   size_t max_cached) {
+  return std::shared_ptr<IOBufferPool>(
+      new IOBufferPool(buffer_size, max_cached));
+}
+
+IOBufferPool::~IOBufferPool() {
+  for (auto block : mFree) {
+    IOBuffer::Block::free(block);
+  }
+}
+
+IOBuffer IOBufferPool::acquire() {
+  IOBuffer::Block *block = nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (!mFree.empty()) {
+      block = mFree.back();
+      mFree.pop_back();
+    }
+  }
+
+  if (block == nullptr) {
+    block = IOBuffer::Block::allocate(mBufferSize);
+  }
+
+  block->refs.store(1, std::memory_order_relaxed);
+  block->size = 0;
+  block->pool = shared_from_this();
+
+  return IOBuffer(block);
+}
+
+size_t IOBufferPool::bufferSize() const noexcept { return mBufferSize; }
+
+size_t IOBufferPool::cachedCount() {
+  std::lock_guard<std::mutex> lock(mLock);
+  return mFree.size();
+}
+
+void IOBufferPool::recycle(IOBuffer::Block *block) noexcept {
+  {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (mFree.size() < mMaxCached) {
+      mFree.push_back(block);
+      return;
+    }
+  }
+
+  IOBuffer::Block::free(block);
+}
+
+} // namespace Context::Devices::IO
@@ -1,10 +1,16 @@
 #include "transport-cpp/iodevice.h"
 
+#include <array>
 #include <cstring>
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+// most buffers handed to a single writev/sendmmsg
+static constexpr size_t WRITE_BATCH_LEN = 64;
+
 namespace Context::Devices::IO {
 
 IODevice::~IODevice() {
@@ -27,6 +33,41 @@ void IODevice::setIODataCallback(const IODATA_CALLBACK &callback) {
   ioDataCallbackSet();
 }
 
+void IODevice::setIOBufferCallback(const IOBUFFER_CALLBACK &callback,
+                                   std::shared_ptr<IOBufferPool> pool) {
+  logDebug("IODevice", "Buffer callback updated");
+
+  mBufferCallback = callback;
+
+  if (pool) {
+    mBufferPool = std::move(pool);
+  } else if (!mBufferPool && mBufferCallback) {
+    mBufferPool = IOBufferPool::create();
+  }
+}
+
+RETURN_CODE IODevice::setFraming(const Framer &framer) {
+  if (!framer.isValid()) {
+    setError(ERROR_CODE::INVALID_ARGUMENT,
+             "Framer needs a fixed length or delimiter");
+    return RETURN::NOK;
+  }
+
+  mFramer = framer;
+  mFramer->reset();
+
+  return RETURN::OK;
+}
+
+void IODevice::clearFraming() noexcept { mFramer.reset(); }
+
+bool IODevice::hasFraming() const noexcept { return mFramer.has_value(); }
+
+void IODevice::setFrameCallback(const FRAME_CALLBACK &callback) {
+  logDebug("IODevice", "Frame callback updated");
+  mFrameCallback = callback;
+}
+
 RETURN_CODE IODevice::asyncSend(const std::shared_ptr<IODATA> &data) {
   if (!isValidForOutgoinAsync() && !deviceIsReady()) {
     setError(ERROR_CODE::INVALID_LOGIC,
@@ -40,9 +81,15 @@ RETURN_CODE IODevice::asyncSend(const std::shared_ptr<IODATA> &data) {
     return RETURN::NOK;
   }
 
-  mIOOutgoingQueue.emplace(data);
+  if (const auto admitted = admitOutgoing(data->size());
+      admitted != RETURN::OK) {
+    return admitted;
+  }
+
+  pushOutgoing(data);
 
   requestWrite();
+  updateSendWatermarks();
 
   return RETURN::OK;
 }
@@ -60,9 +107,15 @@ RETURN_CODE IODevice::asyncSend(std::unique_ptr<IODATA> data) {
     return RETURN::NOK;
   }
 
-  mIOOutgoingQueue.emplace(std::move(data));
+  if (const auto admitted = admitOutgoing(data->size());
+      admitted != RETURN::OK) {
+    return admitted;
+  }
+
+  pushOutgoing(std::move(data));
 
   requestWrite();
+  updateSendWatermarks();
 
   return RETURN::OK;
 }
@@ -80,9 +133,15 @@ RETURN_CODE IODevice::asyncSend(const IODATA &data) {
     return RETURN::NOK;
   }
 
-  mIOOutgoingQueue.emplace(data);
+  if (const auto admitted = admitOutgoing(data.size());
+      admitted != RETURN::OK) {
+    return admitted;
+  }
+
+  pushOutgoing(data);
 
   requestWrite();
+  updateSendWatermarks();
 
   return RETURN::OK;
 }
@@ -212,6 +271,49 @@ IODevice::SYNC_RX_DATA IODevice::syncReceive() {
   return ret;
 }
 
+RETURN_CODE IODevice::setSendWatermarks(size_t low, size_t high) {
+  if (low > high) {
+    setError(ERROR_CODE::INVALID_ARGUMENT,
+             "Low watermark can not be above the high watermark");
+    return RETURN::NOK;
+  }
+
+  mLowWatermark = low;
+  mHighWatermark = high;
+
+  if (mHighWatermark == 0) {
+    mAboveHighWatermark = false;
+  }
+
+  updateSendWatermarks();
+
+  return RETURN::OK;
+}
+
+void IODevice::setHighWatermarkCallback(const WATERMARK_CALLBACK &callback) {
+  mHighWatermarkCallback = callback;
+}
+
+void IODevice::setLowWatermarkCallback(const WATERMARK_CALLBACK &callback) {
+  mLowWatermarkCallback = callback;
+}
+
+size_t IODevice::getQueuedBytes() const noexcept { return mQueuedBytes; }
+
+void IODevice::setSendQueueLimits(const QueueLimits &limits) noexcept {
+  mQueueLimits = limits;
+}
+
+IODevice::QueueLimits IODevice::getSendQueueLimits() const noexcept {
+  return mQueueLimits;
+}
+
+IODevice::QueueStats IODevice::getSendQueueStats() const noexcept {
+  return mQueueStats;
+}
+
+void IODevice::resetSendQueueStats() noexcept { mQueueStats = {}; }
+
 IODevice::IODevice() : Device() {}
 
 void IODevice::ioDataCallbackSet() { /*unused*/
@@ -222,12 +324,39 @@ bool IODevice::deviceIsReady() const { return getDeviceHandle().has_value(); }
 void IODevice::registerNewHandle(DEVICE_HANDLE handle) {
   Device::registerNewHandle(handle);
 
+  // the rest of a partially written message means nothing on a new handle
+  if (mIOHeadOffset != 0) {
+    popOutgoing();
+    updateSendWatermarks();
+  }
+
+  mSocketType = 0;
+
+  // a frame begun on the old handle is never finished
+  if (mFramer) {
+    mFramer->reset();
+  }
+
   if (!handle) {
     return;
   }
 
+  if (mPresetSocketType != 0) {
+    mSocketType = mPresetSocketType;
+    mPresetSocketType = 0;
+    return;
+  }
+
   auto hndl = handle.value();
 
+  int sock_type = 0;
+  socklen_t sock_type_len = sizeof(sock_type);
+
+  if (getsockopt(hndl, SOL_SOCKET, SO_TYPE, &sock_type, &sock_type_len) ==
+      0) {
+    mSocketType = sock_type;
+  }
+
   auto flags = fcntl(hndl, F_GETFL);
 
   if (flags == -1) {
@@ -243,9 +372,162 @@ void IODevice::registerNewHandle(DEVICE_HANDLE handle) {
   }
 }
 
+void IODevice::expectNonBlockingHandle(int socket_type) noexcept {
+  mPresetSocketType = socket_type;
+}
+
+void IODevice::pushOutgoing(IODATA_CHOICE data) {
+  mQueuedBytes += ioDataFromChoice(data).size();
+  mIOOutgoingQueue.emplace_back(std::move(data));
+}
+
+void IODevice::popOutgoing() {
+  mQueuedBytes -=
+      ioDataFromChoice(mIOOutgoingQueue.front()).size() - mIOHeadOffset;
+  mIOOutgoingQueue.pop_front();
+  mIOHeadOffset = 0;
+}
+
+void IODevice::updateSendWatermarks() {
+  if (mHighWatermark == 0) {
+    return;
+  }
+
+  if (!mAboveHighWatermark && mQueuedBytes >= mHighWatermark) {
+    mAboveHighWatermark = true;
+
+    if (mHighWatermarkCallback) {
+      mHighWatermarkCallback(mQueuedBytes);
+    }
+  } else if (mAboveHighWatermark && mQueuedBytes <= mLowWatermark) {
+    mAboveHighWatermark = false;
+
+    if (mLowWatermarkCallback) {
+      mLowWatermarkCallback(mQueuedBytes);
+    }
+  }
+}
+
+RETURN_CODE IODevice::admitOutgoing(size_t size) {
+  if (sendQueueHasRoom(mIOOutgoingQueue.size(), mQueuedBytes, size)) {
+    return RETURN::OK;
+  }
+
+  switch (mQueueLimits.policy) {
+  case QueuePolicy::DROP_NEWEST:
+    countDropped(size);
+    return RETURN::PASSABLE;
+
+  case QueuePolicy::DROP_OLDEST: {
+    // a partly written head has to go out whole or the stream is corrupt
+    const size_t keep = (mIOHeadOffset != 0) ? 1 : 0;
+
+    while (mIOOutgoingQueue.size() > keep &&
+           !sendQueueHasRoom(mIOOutgoingQueue.size(), mQueuedBytes, size)) {
+      const auto oldest = mIOOutgoingQueue.begin() + keep;
+      const auto oldest_size = ioDataFromChoice(*oldest).size();
+
+      mIOOutgoingQueue.erase(oldest);
+      mQueuedBytes -= oldest_size;
+      countDropped(oldest_size);
+    }
+
+    if (sendQueueHasRoom(mIOOutgoingQueue.size(), mQueuedBytes, size)) {
+      return RETURN::OK;
+    }
+
+    break;
+  }
+
+  case QueuePolicy::BLOCK:
+    if (blockForRoom([this, size] {
+          return sendQueueHasRoom(mIOOutgoingQueue.size(), mQueuedBytes,
+                                  size);
+        })) {
+      return RETURN::OK;
+    }
+
+    break;
+
+  case QueuePolicy::REJECT:
+    break;
+  }
+
+  return rejectOutgoing();
+}
+
+bool IODevice::sendQueueHasRoom(size_t count, size_t bytes,
+                                size_t size) const noexcept {
+  if (count == 0) {
+    return true;
+  }
+
+  return (mQueueLimits.max_messages == 0 ||
+          count < mQueueLimits.max_messages) &&
+         (mQueueLimits.max_bytes == 0 ||
+          bytes + size <= mQueueLimits.max_bytes);
+}
+
+void IODevice::countDropped(size_t size) noexcept {
+  mQueueStats.dropped_messages++;
+  mQueueStats.dropped_bytes += size;
+}
+
+RETURN_CODE IODevice::rejectOutgoing() {
+  mQueueStats.rejected++;
+
+  setError(ERROR_CODE::QUEUE_FULL, "Send queue is full, message not queued");
+  return RETURN::FULL;
+}
+
+bool IODevice::blockForRoom(const std::function<bool(void)> &has_room) {
+  if (!deviceIsReady()) {
+    return false;
+  }
+
+  const auto deadline =
+      std::chrono::steady_clock::now() + mQueueLimits.block_timeout;
+
+  pollfd fd;
+
+  fd.events = POLLOUT;
+  fd.fd = getDeviceHandle().value();
+
+  while (!has_room()) {
+    const auto remaining =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now())
+            .count();
+
+    if (remaining <= 0) {
+      return false;
+    }
+
+    const auto nres = poll(&fd, 1,
+                           static_cast<int>(std::min<int64_t>(
+                               remaining, std::numeric_limits<int>::max())));
+
+    if (nres == -1 && errno != EINTR) {
+      return false;
+    }
+
+    if (nres > 0) {
+      if ((fd.revents & POLLOUT) == 0) {
+        return false;
+      }
+
+      readyWrite();
+    }
+  }
+
+  return true;
+}
+
 void IODevice::readyWrite() {
   if (mIOOutgoingQueue.empty()) {
+    // a subclass may have drained the queue itself before coming here
     requestRead();
+    updateSendWatermarks();
     return;
   }
 
@@ -255,22 +537,64 @@ void IODevice::readyWrite() {
     return;
   }
 
-  auto ret = performSyncSend(mIOOutgoingQueue.front());
-
-  mIOOutgoingQueue.pop();
+  const auto drained = (mSocketType == SOCK_DGRAM)
+                           ? drainDatagrams(nullptr, 0)
+                           : drainStream();
 
-  if (ret == RETURN::NOK) {
-    logError("IODevice/readyWrite",
-             "Unable to write to provided file descriptor. Error: " +
-                 std::string(strerror(errno)));
+  if (drained) {
+    requestRead();
+  } else {
+    requestWrite();
   }
 
-  requestWrite();
+  updateSendWatermarks();
 }
 
 void IODevice::readyRead() {
   logDebug("IODevice/readyReady", "incoming data");
 
+  if (hasIOBufferCallback()) {
+    IOBuffer buffer;
+
+    auto read_resp = readIOBuffer(buffer);
+
+    if (!std::holds_alternative<ERROR_CODE>(read_resp.code) ||
+        std::get<ERROR_CODE>(read_resp.code) != ERROR_CODE::NO_ERROR) {
+      logError("IODevice/readyRead",
+               "Error reading descriptor. " + read_resp.description);
+      return;
+    }
+
+    notifyIOBufferCallback(buffer);
+    return;
+  }
+
+  if (hasFraming()) {
+    IODATA frame;
+    bool closed = false;
+
+    auto read_resp = readFrames(
+        [this, &frame](const BYTE *data, size_t size) {
+          notifyFrameCallback(data, size);
+
+          if (hasIODataCallback()) {
+            frame.assign(data, data + size);
+            notifyIOCallback(frame);
+          }
+
+          return getDeviceHandle().has_value();
+        },
+        closed);
+
+    if (!std::holds_alternative<ERROR_CODE>(read_resp.code) ||
+        std::get<ERROR_CODE>(read_resp.code) != ERROR_CODE::NO_ERROR) {
+      logError("IODevice/readyRead",
+               "Error reading descriptor. " + read_resp.description);
+    }
+
+    return;
+  }
+
   IODATA data;
 
   auto read_resp = readIOData(data);
@@ -307,13 +631,88 @@ Device::ERROR IODevice::readIOData(IODATA &data) const noexcept {
   }
 
   while (nbytes > 0) {
-    data.reserve(data.capacity() + static_cast<size_t>(nbytes));
+    data.insert(data.end(), buffer, buffer + nbytes);
 
-    for (int x = 0; x < nbytes; x++) {
-      data.push_back(buffer[x]);
+    nbytes = read(handle, buffer, sizeof(buffer));
+  }
+
+  return err;
+}
+
+Device::ERROR IODevice::readIOBuffer(IOBuffer &buffer) const {
+  ERROR err;
+  err.code = ERROR_CODE::NO_ERROR;
+
+  if (!mBufferPool) {
+    err.code = ERROR_CODE::INVALID_LOGIC;
+    err.description = "No buffer pool has been set";
+    return err;
+  }
+
+  buffer = mBufferPool->acquire();
+
+  // one read per wakeup; the callback may tear the device down, and the
+  // engine calls back again while data remains
+  auto nbytes = read(getDeviceHandle().value(), buffer.data(),
+                     buffer.capacity());
+
+  if (nbytes == -1) {
+    err.code = errno;
+    err.description = "read error";
+    return err;
+  }
+
+  buffer.resize(static_cast<size_t>(nbytes));
+
+  return err;
+}
+
+Device::ERROR IODevice::readFrames(const Framer::FRAME_HANDLER &on_frame,
+                                   bool &closed) {
+  ERROR err;
+  err.code = ERROR_CODE::NO_ERROR;
+  closed = false;
+
+  // frames are views into this, a read only overwrites it once the
+  // previous one's frames have all been handed out
+  static thread_local BYTE buffer[65536];
+
+  while (mFramer && getDeviceHandle()) {
+    auto nbytes = read(getDeviceHandle().value(), buffer, sizeof(buffer));
+
+    if (nbytes == 0) {
+      closed = true;
+      return err;
     }
 
-    nbytes = read(handle, buffer, sizeof(buffer));
+    if (nbytes == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        err.code = errno;
+        err.description = "read error";
+      }
+
+      return err;
+    }
+
+    auto status =
+        mFramer->feed(buffer, static_cast<size_t>(nbytes), on_frame);
+
+    if (status == Framer::Status::TOO_LARGE) {
+      err.code = ERROR_CODE::INVALID_ARGUMENT;
+      err.description = "Frame larger than " +
+                        std::to_string(mFramer->maxFrameSize()) + " bytes";
+      return err;
+    }
+
+    // a short read drained the handle, no need to read EAGAIN back
+    if (status == Framer::Status::STOPPED ||
+        static_cast<size_t>(nbytes) < sizeof(buffer)) {
+      return err;
+    }
   }
 
   return err;
@@ -325,6 +724,26 @@ void IODevice::notifyIOCallback(const IODATA &data) const {
   }
 }
 
+void IODevice::notifyIOBufferCallback(const IOBuffer &buffer) const {
+  if (mBufferCallback) {
+    mBufferCallback(buffer);
+  }
+}
+
+void IODevice::notifyFrameCallback(const BYTE *data, size_t size) const {
+  if (mFrameCallback) {
+    mFrameCallback(data, size);
+  }
+}
+
+bool IODevice::hasIOBufferCallback() const noexcept {
+  return static_cast<bool>(mBufferCallback);
+}
+
+bool IODevice::hasIODataCallback() const noexcept {
+  return static_cast<bool>(mCallback);
+}
+
 bool IODevice::isValidForOutgoinAsync() {
   if (getCurrentLoadedEngine() == nullptr) {
     setError(ERROR_CODE::INVALID_LOGIC,
@@ -350,6 +769,152 @@ bool IODevice::ioDataChoiceValid(const IODATA_CHOICE &data) noexcept {
   return true;
 }
 
+const IODevice::IODATA &
+IODevice::ioDataFromChoice(const IODATA_CHOICE &data) noexcept {
+  if (std::holds_alternative<IODATA>(data)) {
+    return std::get<IODATA>(data);
+  } else if (std::holds_alternative<std::shared_ptr<IODATA>>(data)) {
+    return *std::get<std::shared_ptr<IODATA>>(data);
+  }
+
+  return *std::get<std::unique_ptr<IODATA>>(data);
+}
+
+bool IODevice::drainStream() {
+  const auto handle = getDeviceHandle().value();
+
+  std::array<iovec, WRITE_BATCH_LEN> iov;
+
+  while (!mIOOutgoingQueue.empty()) {
+    size_t count = 0;
+    size_t total = 0;
+
+    for (auto it = mIOOutgoingQueue.begin();
+         it != mIOOutgoingQueue.end() && count < iov.size(); ++it) {
+      const auto &payload = ioDataFromChoice(*it);
+      const auto offset = (it == mIOOutgoingQueue.begin()) ? mIOHeadOffset : 0;
+
+      if (payload.size() <= offset) {
+        continue;
+      }
+
+      iov[count].iov_base = const_cast<BYTE *>(payload.data() + offset);
+      iov[count].iov_len = payload.size() - offset;
+      total += iov[count].iov_len;
+      count++;
+    }
+
+    ssize_t nbytes = 0;
+
+    if (count > 0 && mSocketType != 0) {
+      // sendmsg rather than writev so a closed peer can not raise SIGPIPE
+      msghdr msg = {};
+      msg.msg_iov = iov.data();
+      msg.msg_iovlen = count;
+
+      nbytes = sendmsg(handle, &msg, MSG_NOSIGNAL);
+    } else if (count > 0) {
+      nbytes = writev(handle, iov.data(), static_cast<int>(count));
+    }
+
+    if (nbytes == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return false;
+      }
+
+      setError(errno, "Unable to write to provided file descriptor");
+      logError("IODevice/readyWrite",
+               "Unable to write to provided file descriptor. Error: " +
+                   std::string(strerror(errno)) + ". Dropping message");
+
+      popOutgoing();
+
+      return false;
+    }
+
+    // retire everything fully written, empty messages included
+    auto written = static_cast<size_t>(nbytes);
+
+    while (!mIOOutgoingQueue.empty()) {
+      const auto remaining =
+          ioDataFromChoice(mIOOutgoingQueue.front()).size() - mIOHeadOffset;
+
+      if (written < remaining) {
+        mIOHeadOffset += written;
+        mQueuedBytes -= written;
+        break;
+      }
+
+      written -= remaining;
+      popOutgoing();
+    }
+
+    // a short write means the kernel buffer is full
+    if (static_cast<size_t>(nbytes) < total) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool IODevice::drainDatagrams(const sockaddr *dest, socklen_t dest_len) {
+  const auto handle = getDeviceHandle().value();
+
+  std::array<iovec, WRITE_BATCH_LEN> iov;
+  std::array<mmsghdr, WRITE_BATCH_LEN> msgs;
+
+  while (!mIOOutgoingQueue.empty()) {
+    unsigned count = 0;
+
+    for (auto it = mIOOutgoingQueue.begin();
+         it != mIOOutgoingQueue.end() && count < msgs.size(); ++it) {
+      const auto &payload = ioDataFromChoice(*it);
+
+      iov[count].iov_base = const_cast<BYTE *>(payload.data());
+      iov[count].iov_len = payload.size();
+
+      msgs[count] = {};
+      msgs[count].msg_hdr.msg_name = const_cast<sockaddr *>(dest);
+      msgs[count].msg_hdr.msg_namelen = dest_len;
+      msgs[count].msg_hdr.msg_iov = &iov[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+      count++;
+    }
+
+    const auto nsent = sendmmsg(handle, msgs.data(), count, MSG_NOSIGNAL);
+
+    if (nsent == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return false;
+      }
+
+      setError(errno, "Unable to write to provided file descriptor");
+      logError("IODevice/readyWrite",
+               "Unable to write to provided file descriptor. Error: " +
+                   std::string(strerror(errno)) + ". Dropping message");
+
+      popOutgoing();
+
+      return false;
+    }
+
+    for (int x = 0; x < nsent; x++) {
+      popOutgoing();
+    }
+  }
+
+  return true;
+}
+
 RETURN_CODE IODevice::performSyncSend(const IODATA_CHOICE &data) {
   auto opt_hndl = getDeviceHandle();
 
@@ -362,13 +927,77 @@ RETURN_CODE IODevice::performSyncSend(const IODATA_CHOICE &data) {
 
   auto handle = opt_hndl.value();
 
+  // on a stream the queued messages go first, writing past a partly sent
+  // head would splice this payload into the middle of it
+  if (mSocketType != SOCK_DGRAM && !mIOOutgoingQueue.empty()) {
+    while (!drainStream()) {
+      if (mIOOutgoingQueue.empty()) {
+        break;
+      }
+
+      if (awaitWritable() == RETURN::NOK) {
+        updateSendWatermarks();
+        return RETURN::NOK;
+      }
+    }
+
+    updateSendWatermarks();
+  }
+
+  const auto &payload = ioDataFromChoice(data);
+  size_t offset = 0;
+
+  // keep going until every byte is out, a non-blocking handle may take only
+  // part of the message on each write. POLLOUT is only waited for while the
+  // handle is full
+  do {
+    const auto remaining = payload.size() - offset;
+
+    const auto nbytes =
+        (mSocketType != 0)
+            ? send(handle, payload.data() + offset, remaining, MSG_NOSIGNAL)
+            : write(handle, payload.data() + offset, remaining);
+
+    if (nbytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        setError(errno, "Unable to write to provided file descriptor");
+        return RETURN::NOK;
+      }
+
+      if (awaitWritable() == RETURN::NOK) {
+        return RETURN::NOK;
+      }
+
+      continue;
+    }
+
+    offset += static_cast<size_t>(nbytes);
+  } while (offset < payload.size());
+
+  // leave write interest alone while asynchronous sends are still queued
+  if (mIOOutgoingQueue.empty()) {
+    requestRead();
+  }
+
+  return RETURN::OK;
+}
+
+RETURN_CODE IODevice::awaitWritable() {
   pollfd fd;
 
   fd.events = POLLOUT;
-  fd.fd = handle;
+  fd.fd = getDeviceHandle().value();
 
   auto nres = poll(&fd, 1, -1);
 
+  while (nres == -1 && errno == EINTR) {
+    nres = poll(&fd, 1, -1);
+  }
+
   if (nres == -1) {
     setError(errno, "Device cannot be polled for pollout");
     return RETURN::NOK;
@@ -379,42 +1008,25 @@ RETURN_CODE IODevice::performSyncSend(const IODATA_CHOICE &data) {
     return RETURN::NOK;
   }
 
-  if (fd.revents == POLLERR) {
+  if ((fd.revents & POLLERR) != 0) {
     readyError();
 
     setError(ERROR_CODE::POLL_ERROR, "Poll had an error");
     return RETURN::NOK;
 
-  } else if (fd.revents == POLLHUP) {
+  } else if ((fd.revents & POLLHUP) != 0) {
     readyHangup();
 
     setError(ERROR_CODE::POLL_ERROR, "Peer hung up");
     return RETURN::NOK;
 
-  } else if (fd.revents == POLLRDHUP) {
+  } else if ((fd.revents & POLLRDHUP) != 0) {
     readyPeerDisconnect();
 
     setError(ERROR_CODE::POLL_ERROR, "Peer disconnected");
     return RETURN::NOK;
   }
 
-  const IODATA *data_ptr;
-
-  if (std::holds_alternative<IODATA>(data)) {
-    data_ptr = &std::get<IODATA>(data);
-  } else if (std::holds_alternative<std::shared_ptr<IODATA>>(data)) {
-    data_ptr = std::get<std::shared_ptr<IODATA>>(data).get();
-  } else {
-    data_ptr = std::get<std::unique_ptr<IODATA>>(data).get();
-  }
-
-  if (write(handle, data_ptr->data(), data_ptr->size()) < 0) {
-    setError(errno, "Unable to write to provided file descriptor");
-    return RETURN::NOK;
-  }
-
-  requestRead();
-
   return RETURN::OK;
 }
 } // namespace Context::Devices::IO
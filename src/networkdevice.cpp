@@ -1,12 +1,16 @@
 #include <transport-cpp/networking/networkdevice.h>
 
 #include <arpa/inet.h>
+#include <array>
 #include <cstring>
 #include <fcntl.h>
 #include <ifaddrs.h>
+#include <limits>
+#include <linux/filter.h>
 #include <net/if.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <stdexcept>
 #include <sys/poll.h>
 #include <sys/socket.h>
@@ -16,14 +20,72 @@
 static constexpr int32_t RECV_BUFFER_LEN = 65536;
 static constexpr int32_t IP_NAME_BUF_LEN = 256;
 static constexpr int32_t PORT_BUF_LEN = 256;
+static constexpr size_t SEND_BATCH_LEN = 64;
+static constexpr size_t RECV_BATCH_LEN = 32;
+
+struct GRO_CONTROL {
+  alignas(cmsghdr) char buffer[CMSG_SPACE(sizeof(int))];
+};
 
 namespace Context::Devices::IO::Networking {
 void NetworkDevice::setGenericNetworkCallback(const RX_CALLBACK &callback) {
   mCallback = callback;
 }
 
+void NetworkDevice::setBatchNetworkCallback(
+    const RX_BATCH_CALLBACK &callback) {
+  mBatchCallback = callback;
+}
+
 RETURN_CODE NetworkDevice::sendTo(const HostAddr &dest, const IODATA &message,
                                   const IPVersion &ip_hint) {
+  ResolvedAddr addr;
+
+  if (resolve(dest, addr, ip_hint) == RETURN::NOK) {
+    return RETURN::NOK;
+  }
+
+  return sendTo(addr, message);
+}
+
+RETURN_CODE NetworkDevice::sendTo(const HostAddr &dest,
+                                  const std::shared_ptr<IODATA> &message,
+                                  const IPVersion &ip_hint) {
+  ResolvedAddr addr;
+
+  if (resolve(dest, addr, ip_hint) == RETURN::NOK) {
+    return RETURN::NOK;
+  }
+
+  return sendTo(addr, message);
+}
+
+RETURN_CODE NetworkDevice::sendTo(const HostAddr &dest,
+                                  std::unique_ptr<IODATA> message,
+                                  const IPVersion &ip_hint) {
+  ResolvedAddr addr;
+
+  if (resolve(dest, addr, ip_hint) == RETURN::NOK) {
+    return RETURN::NOK;
+  }
+
+  return sendTo(addr, std::move(message));
+}
+
+RETURN_CODE NetworkDevice::syncSendTo(const HostAddr &dest,
+                                      const IODATA_CHOICE &message,
+                                      const IPVersion &ip_hint) {
+  ResolvedAddr addr;
+
+  if (resolve(dest, addr, ip_hint) == RETURN::NOK) {
+    return RETURN::NOK;
+  }
+
+  return syncSendTo(addr, message);
+}
+
+RETURN_CODE NetworkDevice::sendTo(const ResolvedAddr &dest,
+                                  const IODATA &message) {
   if (!isValidForOutgoinAsync()) {
     return RETURN::NOK;
   }
@@ -34,16 +96,21 @@ RETURN_CODE NetworkDevice::sendTo(const HostAddr &dest, const IODATA &message,
     return RETURN::NOK;
   }
 
-  mOutgoingQueue.emplace(dest, message, ip_hint);
+  if (const auto admitted = admitOutgoingMessage(message.size());
+      admitted != RETURN::OK) {
+    return admitted;
+  }
+
+  mOutgoingQueue.emplace_back(dest, message);
+  mOutgoingBytes += message.size();
 
   requestWrite();
 
   return RETURN::OK;
 }
 
-RETURN_CODE NetworkDevice::sendTo(const HostAddr &dest,
-                                  const std::shared_ptr<IODATA> &message,
-                                  const IPVersion &ip_hint) {
+RETURN_CODE NetworkDevice::sendTo(const ResolvedAddr &dest,
+                                  const std::shared_ptr<IODATA> &message) {
   if (!isValidForOutgoinAsync()) {
     return RETURN::NOK;
   }
@@ -54,16 +121,21 @@ RETURN_CODE NetworkDevice::sendTo(const HostAddr &dest,
     return RETURN::NOK;
   }
 
-  mOutgoingQueue.emplace(dest, message, ip_hint);
+  if (const auto admitted = admitOutgoingMessage(message->size());
+      admitted != RETURN::OK) {
+    return admitted;
+  }
+
+  mOutgoingQueue.emplace_back(dest, message);
+  mOutgoingBytes += message->size();
 
   requestWrite();
 
   return RETURN::OK;
 }
 
-RETURN_CODE NetworkDevice::sendTo(const HostAddr &dest,
-                                  std::unique_ptr<IODATA> message,
-                                  const IPVersion &ip_hint) {
+RETURN_CODE NetworkDevice::sendTo(const ResolvedAddr &dest,
+                                  std::unique_ptr<IODATA> message) {
   if (!isValidForOutgoinAsync()) {
     return RETURN::NOK;
   }
@@ -74,23 +146,130 @@ RETURN_CODE NetworkDevice::sendTo(const HostAddr &dest,
     return RETURN::NOK;
   }
 
-  mOutgoingQueue.emplace(dest, std::move(message), ip_hint);
+  if (const auto admitted = admitOutgoingMessage(message->size());
+      admitted != RETURN::OK) {
+    return admitted;
+  }
+
+  mOutgoingBytes += message->size();
+  mOutgoingQueue.emplace_back(dest, std::move(message));
 
   requestWrite();
 
   return RETURN::OK;
 }
 
-RETURN_CODE NetworkDevice::syncSendTo(const HostAddr &dest,
-                                      const IODATA_CHOICE &message,
-                                      const IPVersion &ip_hint) {
+RETURN_CODE NetworkDevice::syncSendTo(const ResolvedAddr &dest,
+                                      const IODATA_CHOICE &message) {
   if (!ioDataChoiceValid(message)) {
     setError(ERROR_CODE::INVALID_LOGIC,
              "Provided data has not been initialised");
     return RETURN::NOK;
   }
 
-  return performSendTo(dest, message, ip_hint);
+  return performSendTo(dest, message);
+}
+
+RETURN_CODE NetworkDevice::resolve(const HostAddr &dest, ResolvedAddr &addr,
+                                   const IPVersion &ip_hint) {
+  if (const auto cached = mAddrCache.find(dest, ip_hint); cached != nullptr) {
+    addr = *cached;
+    return RETURN::OK;
+  }
+
+  if (resolveAddress(dest, ip_hint, addr) == RETURN::NOK) {
+    return RETURN::NOK;
+  }
+
+  mAddrCache.insert(dest, ip_hint, addr);
+
+  return RETURN::OK;
+}
+
+void NetworkDevice::setAddrCacheLimits(const AddrCacheLimits &limits) {
+  mAddrCache.setLimits(limits);
+}
+
+AddrCacheLimits NetworkDevice::getAddrCacheLimits() const noexcept {
+  return mAddrCache.getLimits();
+}
+
+void NetworkDevice::invalidateAddrCache() noexcept { mAddrCache.invalidate(); }
+
+void NetworkDevice::invalidateAddrCache(const HostAddr &dest) noexcept {
+  mAddrCache.invalidate(dest);
+}
+
+RETURN_CODE NetworkDevice::sendBatch(const NetworkMessage *messages,
+                                     size_t count, size_t &sent) {
+  sent = 0;
+
+  if (!getDeviceHandle()) {
+    setError(ERROR_CODE::INVALID_LOGIC,
+             "Cannot send without first initialising a socket");
+    return RETURN::NOK;
+  }
+
+  const auto sock = getDeviceHandle().value();
+
+  std::array<ResolvedAddr, SEND_BATCH_LEN> addrs;
+  std::array<iovec, SEND_BATCH_LEN> iov;
+  std::array<mmsghdr, SEND_BATCH_LEN> msgs;
+
+  while (sent < count) {
+    const auto chunk = std::min(count - sent, SEND_BATCH_LEN);
+
+    for (size_t x = 0; x < chunk; x++) {
+      const auto &message = messages[sent + x];
+
+      if (!message.peer.isValid()) {
+        setError(ERROR_CODE::INVALID_ARGUMENT,
+                 "Batched message has no valid peer address");
+        return RETURN::NOK;
+      }
+
+      addrs[x] = message.peer;
+
+      iov[x].iov_base = const_cast<BYTE *>(message.data.data());
+      iov[x].iov_len = message.data.size();
+
+      msgs[x] = {};
+      msgs[x].msg_hdr.msg_name = &addrs[x].addr;
+      msgs[x].msg_hdr.msg_namelen = addrs[x].addr_len;
+      msgs[x].msg_hdr.msg_iov = &iov[x];
+      msgs[x].msg_hdr.msg_iovlen = 1;
+    }
+
+    const auto nsent = sendmmsg(sock, msgs.data(),
+                                static_cast<unsigned>(chunk), MSG_NOSIGNAL);
+
+    if (nsent == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        setError(errno, "System error returned when performing a sendTo");
+        return RETURN::NOK;
+      }
+
+      if (awaitWritable() == RETURN::NOK) {
+        return RETURN::NOK;
+      }
+
+      continue;
+    }
+
+    sent += static_cast<size_t>(nsent);
+  }
+
+  return RETURN::OK;
+}
+
+RETURN_CODE
+NetworkDevice::sendBatch(const std::vector<NetworkMessage> &messages,
+                         size_t &sent) {
+  return sendBatch(messages.data(), messages.size(), sent);
 }
 
 RETURN_CODE NetworkDevice::getLocalAddress(HostAddr &addr) noexcept {
@@ -140,72 +319,225 @@ RETURN_CODE NetworkDevice::getLocalAddress(HostAddr &addr) noexcept {
   return RETURN::OK;
 }
 
+RETURN_CODE
+NetworkDevice::setBusyPoll(const std::chrono::microseconds &budget) noexcept {
+  if (budget.count() < 0 || budget.count() > std::numeric_limits<int>::max()) {
+    setError(ERROR_CODE::INVALID_ARGUMENT, "Busy poll budget out of range");
+    return RETURN::NOK;
+  }
+
+  mBusyPoll = budget;
+
+  if (!deviceIsReady()) {
+    return RETURN::OK;
+  }
+
+  return applyBusyPoll();
+}
+
+RETURN_CODE NetworkDevice::setGsoSegmentSize(uint16_t segment_size) noexcept {
+  mGsoSegmentSize = segment_size;
+
+  if (!deviceIsReady()) {
+    return RETURN::OK;
+  }
+
+  return applyGso();
+}
+
+RETURN_CODE NetworkDevice::setGroEnabled(bool enable) noexcept {
+  mGroEnabled = enable;
+
+  if (!deviceIsReady()) {
+    return RETURN::OK;
+  }
+
+  return applyGro();
+}
+
+void NetworkDevice::setReusePort(bool enable) noexcept { mReusePort = enable; }
+
+bool NetworkDevice::getReusePort() const noexcept { return mReusePort; }
+
+RETURN_CODE
+NetworkDevice::attachReusePortCpuSteering(unsigned group_size) noexcept {
+  if (group_size == 0) {
+    setError(ERROR_CODE::INVALID_ARGUMENT, "Group size must be at least 1");
+    return RETURN::NOK;
+  }
+
+  if (!deviceIsReady()) {
+    setError(ERROR_CODE::DEVICE_NOT_READY,
+             "Socket must be bound before steering can be attached");
+    return RETURN::NOK;
+  }
+
+  // A = current cpu % group_size, the index of the socket to deliver to
+  sock_filter code[] = {
+      {BPF_LD | BPF_W | BPF_ABS, 0, 0,
+       static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)},
+      {BPF_ALU | BPF_MOD | BPF_K, 0, 0, group_size},
+      {BPF_RET | BPF_A, 0, 0, 0},
+  };
+
+  sock_fprog program = {};
+  program.len = sizeof(code) / sizeof(code[0]);
+  program.filter = code;
+
+  if (setsockopt(getDeviceHandle().value(), SOL_SOCKET,
+                 SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) == -1) {
+    setError(errno, "Unable to attach SO_REUSEPORT steering program");
+    return RETURN::NOK;
+  }
+
+  return RETURN::OK;
+}
+
+void NetworkDevice::registerNewHandle(DEVICE_HANDLE handle) {
+  IODevice::registerNewHandle(handle);
+
+  if (!handle) {
+    return;
+  }
+
+  if (mBusyPoll.count() > 0 && applyBusyPoll() == RETURN::NOK) {
+    logLastError("NetworkDevice/registerNewHandle");
+  }
+
+  if (mGsoSegmentSize > 0 && applyGso() == RETURN::NOK) {
+    logLastError("NetworkDevice/registerNewHandle");
+  }
+
+  if (mGroEnabled && applyGro() == RETURN::NOK) {
+    logLastError("NetworkDevice/registerNewHandle");
+  }
+}
+
 NetworkDevice::NetworkDevice() : IODevice() {}
 
-Device::ERROR NetworkDevice::receiveMessage(NetworkMessage &message) const {
+Device::ERROR NetworkDevice::receiveMessages(size_t &count) {
   ERROR err;
   err.code = ERROR_CODE::NO_ERROR;
-
-  thread_local char buffer[RECV_BUFFER_LEN];
+  count = 0;
+
+  // datagrams land in one slot each, sized for the largest a UDP socket
+  // can return
+  thread_local std::vector<char> buffer(RECV_BATCH_LEN * RECV_BUFFER_LEN);
+  thread_local std::array<sockaddr_storage, RECV_BATCH_LEN> peer_addrs;
+  thread_local std::array<iovec, RECV_BATCH_LEN> iov;
+  thread_local std::array<mmsghdr, RECV_BATCH_LEN> msgs;
+  // room for the UDP_GRO segment size
+  thread_local std::array<GRO_CONTROL, RECV_BATCH_LEN> controls;
+
+  for (size_t x = 0; x < RECV_BATCH_LEN; x++) {
+    iov[x].iov_base = buffer.data() + x * RECV_BUFFER_LEN;
+    iov[x].iov_len = RECV_BUFFER_LEN;
+
+    msgs[x] = {};
+    msgs[x].msg_hdr.msg_name = &peer_addrs[x];
+    msgs[x].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+    msgs[x].msg_hdr.msg_iov = &iov[x];
+    msgs[x].msg_hdr.msg_iovlen = 1;
+
+    if (mGroEnabled) {
+      msgs[x].msg_hdr.msg_control = controls[x].buffer;
+      msgs[x].msg_hdr.msg_controllen = sizeof(controls[x].buffer);
+    }
+  }
 
   const auto handle = getDeviceHandle().value();
 
-  sockaddr peer_addr;
-  socklen_t peer_addr_len = sizeof(peer_addr);
+  const auto nmsgs =
+      recvmmsg(handle, msgs.data(), RECV_BATCH_LEN, MSG_DONTWAIT, nullptr);
 
-  auto nbytes =
-      recvfrom(handle, buffer, RECV_BUFFER_LEN, 0,
-               reinterpret_cast<sockaddr *>(&peer_addr), &peer_addr_len);
+  if (nmsgs == -1) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      err.code = errno;
+      err.description = "read error";
+    }
 
-  if (nbytes == -1) {
-    err.code = errno;
-    err.description = "read error";
-  } else {
-    char ip[IP_NAME_BUF_LEN];
+    return err;
+  }
 
-    if (peer_addr.sa_family == AF_INET) {
-      auto ipv4_addr = reinterpret_cast<sockaddr_in *>(&peer_addr);
-      message.peer.port = ntohs(ipv4_addr->sin_port);
+  for (int x = 0; x < nmsgs; x++) {
+    const Endpoint peer(peer_addrs[x]);
 
-      if (inet_ntop(AF_INET, &ipv4_addr->sin_addr, ip, IP_NAME_BUF_LEN) ==
-          nullptr) {
-        err.code = errno;
-        err.description = "Unable to convert peer ipv4 addr to string";
-        return err;
-      }
-    } else if (peer_addr.sa_family == AF_INET6) {
-      auto ipv6_addr = reinterpret_cast<sockaddr_in6 *>(&peer_addr);
-      message.peer.port = ntohs(ipv6_addr->sin6_port);
-
-      if (inet_ntop(AF_INET6, &ipv6_addr->sin6_addr, ip, IP_NAME_BUF_LEN) ==
-          nullptr) {
-        err.code = errno;
-        err.description = "Unable to convert peer ipv6 addr to string";
-        return err;
-      }
-    } else {
+    if (!peer.isValid()) {
       err.code = ERROR_CODE::GENERAL_ERROR;
       err.description = "Unknown peer address type";
-      return err;
+      continue;
     }
 
-    message.peer.ip = ip;
-  }
+    const auto data = static_cast<const char *>(iov[x].iov_base);
+    const size_t length = msgs[x].msg_len;
 
-  while (nbytes > 0) {
-    message.data.reserve(message.data.capacity() + static_cast<size_t>(nbytes));
+    // a coalesced GRO read is split back into its datagrams
+    size_t segment_size = length;
 
-    for (int x = 0; x < nbytes; x++) {
-      message.data.push_back(buffer[x]);
+    if (mGroEnabled) {
+      segment_size = groSegmentSize(msgs[x].msg_hdr, length);
     }
 
-    nbytes = recvfrom(handle, buffer, RECV_BUFFER_LEN, 0, &peer_addr,
-                      &peer_addr_len);
+    for (size_t offset = 0; offset < length || offset == 0;
+         offset += segment_size) {
+      if (mReceiveBatch.size() <= count) {
+        mReceiveBatch.resize(count + 1);
+      }
+
+      auto &message = mReceiveBatch[count];
+      const auto end = std::min(length, offset + segment_size);
+
+      message.peer = peer;
+      message.data.assign(data + offset, data + end);
+      count++;
+
+      if (segment_size == 0) {
+        break;
+      }
+    }
   }
 
   return err;
 }
 
+size_t NetworkDevice::groSegmentSize(const msghdr &header,
+                                     size_t length) noexcept {
+  for (auto cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(const_cast<msghdr *>(&header), cmsg)) {
+    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+      int segment_size = 0;
+      memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+
+      if (segment_size > 0) {
+        return static_cast<size_t>(segment_size);
+      }
+    }
+  }
+
+  return length;
+}
+
+RETURN_CODE NetworkDevice::getRemoteEndpoint(Endpoint &endpoint) noexcept {
+  if (!getDeviceHandle()) {
+    setError(ERROR_CODE::INVALID_LOGIC,
+             "Device has no socket, unable to get remote address");
+    return RETURN::NOK;
+  }
+
+  sockaddr_storage addr = {};
+  socklen_t addr_len = sizeof(addr);
+
+  if (getpeername(getDeviceHandle().value(),
+                  reinterpret_cast<sockaddr *>(&addr), &addr_len) == -1) {
+    setError(errno, "Unable to get remote socket address");
+    return RETURN::NOK;
+  }
+
+  endpoint = Endpoint(addr);
+
+  return RETURN::OK;
+}
+
 void NetworkDevice::notifyCallback(const NetworkMessage &message) const {
   if (mCallback) {
     mCallback(message);
@@ -214,6 +546,17 @@ void NetworkDevice::notifyCallback(const NetworkMessage &message) const {
   notifyIOCallback(message.data);
 }
 
+bool NetworkDevice::hasMessageCallback() const noexcept {
+  return static_cast<bool>(mCallback) || hasIODataCallback();
+}
+
+void NetworkDevice::notifyBatchCallback(const NetworkMessage *messages,
+                                        size_t count) const {
+  if (mBatchCallback) {
+    mBatchCallback(messages, count);
+  }
+}
+
 RETURN_CODE
 NetworkDevice::createAndConnectSocket(const HostAddr &host,
                                       const IPVersion &ip_hint,
@@ -340,51 +683,182 @@ RETURN_CODE NetworkDevice::createAndBindSocket(const HostAddr &host,
 }
 
 void NetworkDevice::readyRead() {
-  NetworkMessage data;
+  if (hasIOBufferCallback()) {
+    IODevice::readyRead();
+    return;
+  }
 
-  auto read_resp = receiveMessage(data);
+  size_t count = 0;
+
+  auto read_resp = receiveMessages(count);
 
   if (!std::holds_alternative<ERROR_CODE>(read_resp.code) ||
       std::get<ERROR_CODE>(read_resp.code) != ERROR_CODE::NO_ERROR) {
     logError("NetworkDevice/readyRead",
              "Error reading descriptor. " + read_resp.description);
+  }
+
+  if (count == 0) {
     return;
   }
 
-  notifyCallback(data);
+  notifyBatchCallback(mReceiveBatch.data(), count);
+
+  for (size_t x = 0; x < count; x++) {
+    notifyCallback(mReceiveBatch[x]);
+  }
 }
 
 void NetworkDevice::readyWrite() {
-  if (mOutgoingQueue.empty()) {
-    IODevice::readyWrite();
+  if (!mOutgoingQueue.empty() && !drainOutgoingMessages()) {
+    requestWrite();
     return;
   }
 
-  const auto &[dest, message, ip_hint] = mOutgoingQueue.front();
-  auto ret = performSendTo(dest, message, ip_hint);
+  IODevice::readyWrite();
+}
+
+bool NetworkDevice::drainOutgoingMessages() {
+  if (!getDeviceHandle()) {
+    logError("NetworkDevice/readyWrite",
+             "Somehow got to readyWrite without a configured socket");
+    return false;
+  }
+
+  const auto sock = getDeviceHandle().value();
+
+  std::array<iovec, SEND_BATCH_LEN> iov;
+  std::array<mmsghdr, SEND_BATCH_LEN> msgs;
+
+  while (!mOutgoingQueue.empty()) {
+    unsigned count = 0;
+
+    for (const auto &[dest, message] : mOutgoingQueue) {
+      if (count == msgs.size()) {
+        break;
+      }
+
+      const auto &payload = ioDataFromChoice(message);
+
+      iov[count].iov_base = const_cast<BYTE *>(payload.data());
+      iov[count].iov_len = payload.size();
+
+      msgs[count] = {};
+      msgs[count].msg_hdr.msg_name =
+          const_cast<sockaddr_storage *>(&dest.addr);
+      msgs[count].msg_hdr.msg_namelen = dest.addr_len;
+      msgs[count].msg_hdr.msg_iov = &iov[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+      count++;
+    }
+
+    const auto nsent = sendmmsg(sock, msgs.data(), count, MSG_NOSIGNAL);
 
-  if (ret == RETURN::NOK) {
-    auto last_error = getLastError();
+    if (nsent == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
 
-    if (std::holds_alternative<int>(last_error.code)) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return false;
+      }
+
+      setError(errno, "System error returned when performing a sendTo");
       logError("NetworkDevice/readyWrite",
                "[Sys] Unable to send to an address. "
                "Error code description: " +
-                   std::string(strerror(std::get<int>(last_error.code))));
-    } else {
-      logError("NetworkDevice/readyWrite",
-               "[Internal error] Unable to send to. Desc: " +
-                   last_error.description);
+                   std::string(strerror(errno)));
+      popOutgoingMessage();
+      continue;
+    }
+
+    for (int x = 0; x < nsent; x++) {
+      popOutgoingMessage();
     }
   }
 
-  mOutgoingQueue.pop();
-  requestWrite();
+  return true;
+}
+
+RETURN_CODE NetworkDevice::admitOutgoingMessage(size_t size) {
+  if (sendQueueHasRoom(mOutgoingQueue.size(), mOutgoingBytes, size)) {
+    return RETURN::OK;
+  }
+
+  switch (getSendQueueLimits().policy) {
+  case QueuePolicy::DROP_NEWEST:
+    countDropped(size);
+    return RETURN::PASSABLE;
+
+  case QueuePolicy::DROP_OLDEST:
+    while (!mOutgoingQueue.empty() &&
+           !sendQueueHasRoom(mOutgoingQueue.size(), mOutgoingBytes, size)) {
+      countDropped(ioDataFromChoice(mOutgoingQueue.front().data).size());
+      popOutgoingMessage();
+    }
+
+    return RETURN::OK;
+
+  case QueuePolicy::BLOCK:
+    if (blockForRoom([this, size] {
+          return sendQueueHasRoom(mOutgoingQueue.size(), mOutgoingBytes,
+                                  size);
+        })) {
+      return RETURN::OK;
+    }
+
+    break;
+
+  case QueuePolicy::REJECT:
+    break;
+  }
+
+  return rejectOutgoing();
+}
+
+void NetworkDevice::popOutgoingMessage() {
+  mOutgoingBytes -= ioDataFromChoice(mOutgoingQueue.front().data).size();
+  mOutgoingQueue.pop_front();
+}
+
+RETURN_CODE NetworkDevice::applyGso() noexcept {
+  const int segment_size = mGsoSegmentSize;
+
+  if (setsockopt(getDeviceHandle().value(), SOL_UDP, UDP_SEGMENT,
+                 &segment_size, sizeof(segment_size)) == -1) {
+    setError(errno, "Unable to set UDP_SEGMENT");
+    return RETURN::NOK;
+  }
+
+  return RETURN::OK;
+}
+
+RETURN_CODE NetworkDevice::applyGro() noexcept {
+  const int enable = mGroEnabled;
+
+  if (setsockopt(getDeviceHandle().value(), SOL_UDP, UDP_GRO, &enable,
+                 sizeof(enable)) == -1) {
+    setError(errno, "Unable to set UDP_GRO");
+    return RETURN::NOK;
+  }
+
+  return RETURN::OK;
+}
+
+RETURN_CODE NetworkDevice::applyBusyPoll() noexcept {
+  const auto usecs = static_cast<int>(mBusyPoll.count());
+
+  if (setsockopt(getDeviceHandle().value(), SOL_SOCKET, SO_BUSY_POLL, &usecs,
+                 sizeof(usecs)) == -1) {
+    setError(errno, "Unable to set SO_BUSY_POLL");
+    return RETURN::NOK;
+  }
+
+  return RETURN::OK;
 }
 
-RETURN_CODE NetworkDevice::performSendTo(const HostAddr &dest,
-                                         const IODATA_CHOICE &data,
-                                         const IPVersion &ip_hint) {
+RETURN_CODE NetworkDevice::performSendTo(const ResolvedAddr &dest,
+                                         const IODATA_CHOICE &data) {
   if (!getDeviceHandle()) {
     setError(ERROR_CODE::INVALID_LOGIC,
              "Cannot send without first initialising a socket");
@@ -393,6 +867,23 @@ RETURN_CODE NetworkDevice::performSendTo(const HostAddr &dest,
 
   auto sock = getDeviceHandle().value();
 
+  const auto &payload = ioDataFromChoice(data);
+
+  auto nWrote =
+      sendto(sock, payload.data(), payload.size(), MSG_NOSIGNAL,
+             reinterpret_cast<const sockaddr *>(&dest.addr), dest.addr_len);
+
+  if (nWrote < 0) {
+    setError(errno, "System error returned when performing a sendTo");
+    return RETURN::NOK;
+  }
+
+  return RETURN::OK;
+}
+
+RETURN_CODE NetworkDevice::resolveAddress(const HostAddr &dest,
+                                          const IPVersion &ip_hint,
+                                          ResolvedAddr &addr) {
   AddrInfo info;
 
   addrinfo hints = {};
@@ -424,23 +915,8 @@ RETURN_CODE NetworkDevice::performSendTo(const HostAddr &dest,
     return RETURN::NOK;
   }
 
-  const IODATA *data_ptr;
-
-  if (std::holds_alternative<IODATA>(data)) {
-    data_ptr = &std::get<IODATA>(data);
-  } else if (std::holds_alternative<std::shared_ptr<IODATA>>(data)) {
-    data_ptr = std::get<std::shared_ptr<IODATA>>(data).get();
-  } else {
-    data_ptr = std::get<std::unique_ptr<IODATA>>(data).get();
-  }
-
-  auto nWrote = sendto(sock, data_ptr->data(), data_ptr->size(), 0,
-                       next_info->ai_addr, next_info->ai_addrlen);
-
-  if (nWrote < 0) {
-    setError(errno, "System error returned when performing a sendTo");
-    return RETURN::NOK;
-  }
+  memcpy(&addr.addr, next_info->ai_addr, next_info->ai_addrlen);
+  addr.addr_len = next_info->ai_addrlen;
 
   return RETURN::OK;
 }
@@ -590,9 +1066,208 @@ RETURN_CODE NetworkDevice::sockToReuse(const DEVICE_HANDLE &handle) {
     return RETURN::NOK;
   }
 
+  if (mReusePort &&
+      setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) == -1) {
+    setError(errno, "Unable to configure socket for port sharing");
+    return RETURN::NOK;
+  }
+
   return RETURN::OK;
 }
 
+Endpoint::Endpoint(const sockaddr_storage &addr) noexcept {
+  if (addr.ss_family == AF_INET) {
+    const auto ipv4_addr = reinterpret_cast<const sockaddr_in *>(&addr);
+
+    mFamily = AF_INET;
+    mPort = ntohs(ipv4_addr->sin_port);
+    memcpy(mAddr.data(), &ipv4_addr->sin_addr, sizeof(ipv4_addr->sin_addr));
+  } else if (addr.ss_family == AF_INET6) {
+    const auto ipv6_addr = reinterpret_cast<const sockaddr_in6 *>(&addr);
+
+    mFamily = AF_INET6;
+    mPort = ntohs(ipv6_addr->sin6_port);
+    mScopeId = ipv6_addr->sin6_scope_id;
+    memcpy(mAddr.data(), &ipv6_addr->sin6_addr, sizeof(ipv6_addr->sin6_addr));
+  }
+}
+
+Endpoint::Endpoint(const ResolvedAddr &addr) noexcept : Endpoint(addr.addr) {}
+
+bool Endpoint::isValid() const noexcept { return mFamily != AF_UNSPEC; }
+
+IPVersion Endpoint::version() const noexcept {
+  if (mFamily == AF_INET) {
+    return IPVersion::IPv4;
+  }
+
+  if (mFamily == AF_INET6) {
+    return IPVersion::IPv6;
+  }
+
+  return IPVersion::ANY;
+}
+
+PORT Endpoint::port() const noexcept { return mPort; }
+
+ADDR Endpoint::ip() const {
+  if (!isValid()) {
+    return {};
+  }
+
+  char ip[INET6_ADDRSTRLEN];
+
+  if (inet_ntop(mFamily, mAddr.data(), ip, sizeof(ip)) == nullptr) {
+    return {};
+  }
+
+  return ip;
+}
+
+HostAddr Endpoint::toHostAddr() const { return {ip(), mPort}; }
+
+size_t Endpoint::hash() const noexcept {
+  uint64_t high = 0;
+  uint64_t low = 0;
+
+  memcpy(&high, mAddr.data(), sizeof(high));
+  memcpy(&low, mAddr.data() + sizeof(high), sizeof(low));
+
+  auto seed = high ^ (low * 0x9e3779b97f4a7c15ULL) ^
+              (static_cast<uint64_t>(mPort) << 48) ^
+              (static_cast<uint64_t>(mFamily) << 32) ^ mScopeId;
+
+  // finaliser of splitmix64, so the low bits used for bucketing mix in the
+  // whole key
+  seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebULL;
+
+  return static_cast<size_t>(seed ^ (seed >> 31));
+}
+
+bool Endpoint::operator==(const Endpoint &other) const noexcept {
+  return mFamily == other.mFamily && mPort == other.mPort &&
+         mScopeId == other.mScopeId && mAddr == other.mAddr;
+}
+
+bool Endpoint::operator!=(const Endpoint &other) const noexcept {
+  return !(*this == other);
+}
+
+ResolvedAddr::ResolvedAddr(const Endpoint &endpoint) noexcept {
+  if (endpoint.mFamily == AF_INET) {
+    auto ipv4_addr = reinterpret_cast<sockaddr_in *>(&addr);
+
+    ipv4_addr->sin_family = AF_INET;
+    ipv4_addr->sin_port = htons(endpoint.mPort);
+    memcpy(&ipv4_addr->sin_addr, endpoint.mAddr.data(),
+           sizeof(ipv4_addr->sin_addr));
+    addr_len = sizeof(sockaddr_in);
+  } else if (endpoint.mFamily == AF_INET6) {
+    auto ipv6_addr = reinterpret_cast<sockaddr_in6 *>(&addr);
+
+    ipv6_addr->sin6_family = AF_INET6;
+    ipv6_addr->sin6_port = htons(endpoint.mPort);
+    ipv6_addr->sin6_scope_id = endpoint.mScopeId;
+    memcpy(&ipv6_addr->sin6_addr, endpoint.mAddr.data(),
+           sizeof(ipv6_addr->sin6_addr));
+    addr_len = sizeof(sockaddr_in6);
+  }
+}
+
+bool AddrCache::Key::operator==(const Key &other) const noexcept {
+  return port == other.port && ip_hint == other.ip_hint && ip == other.ip;
+}
+
+size_t AddrCache::KeyHash::operator()(const Key &key) const noexcept {
+  auto seed = std::hash<ADDR>{}(key.ip);
+
+  seed ^= (static_cast<size_t>(key.port) << 2) ^
+          static_cast<size_t>(key.ip_hint);
+
+  return seed;
+}
+
+const ResolvedAddr *AddrCache::find(const HostAddr &dest,
+                                    const IPVersion &ip_hint) {
+  if (mIndex.empty()) {
+    return nullptr;
+  }
+
+  const auto found = mIndex.find({dest.ip, dest.port, ip_hint});
+
+  if (found == mIndex.end()) {
+    return nullptr;
+  }
+
+  const auto entry = found->second;
+
+  if (CLOCK::now() - entry->resolved_at >= mLimits.ttl) {
+    mEntries.erase(entry);
+    mIndex.erase(found);
+    return nullptr;
+  }
+
+  mEntries.splice(mEntries.begin(), mEntries, entry);
+
+  return &entry->addr;
+}
+
+void AddrCache::insert(const HostAddr &dest, const IPVersion &ip_hint,
+                       const ResolvedAddr &addr) {
+  if (mLimits.capacity == 0) {
+    return;
+  }
+
+  Key key{dest.ip, dest.port, ip_hint};
+
+  erase(key);
+
+  mEntries.push_front({key, addr, CLOCK::now()});
+  mIndex.emplace(std::move(key), mEntries.begin());
+
+  evictToCapacity();
+}
+
+void AddrCache::invalidate() noexcept {
+  mIndex.clear();
+  mEntries.clear();
+}
+
+void AddrCache::invalidate(const HostAddr &dest) noexcept {
+  for (const auto ip_hint :
+       {IPVersion::ANY, IPVersion::IPv4, IPVersion::IPv6}) {
+    erase({dest.ip, dest.port, ip_hint});
+  }
+}
+
+void AddrCache::setLimits(const AddrCacheLimits &limits) {
+  mLimits = limits;
+  evictToCapacity();
+}
+
+AddrCacheLimits AddrCache::getLimits() const noexcept { return mLimits; }
+
+size_t AddrCache::size() const noexcept { return mEntries.size(); }
+
+void AddrCache::erase(const Key &key) noexcept {
+  const auto found = mIndex.find(key);
+
+  if (found == mIndex.end()) {
+    return;
+  }
+
+  mEntries.erase(found->second);
+  mIndex.erase(found);
+}
+
+void AddrCache::evictToCapacity() noexcept {
+  while (mEntries.size() > mLimits.capacity) {
+    mIndex.erase(mEntries.back().key);
+    mEntries.pop_back();
+  }
+}
+
 AddrInfo::~AddrInfo() {
   if (!mInfo) {
     return;
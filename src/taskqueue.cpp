@@ -0,0 +1,40 @@
+#include <transport-cpp/taskqueue.h>
+
+namespace Context {
+
+TaskQueue::TaskQueue() : mHead(new Node), mTail(mHead.load()) {}
+
+TaskQueue::~TaskQueue() {
+  while (mTail != nullptr) {
+    auto next = mTail->next.load(std::memory_order_relaxed);
+    delete mTail;
+    mTail = next;
+  }
+}
+
+void TaskQueue::push(TASK task) {
+  auto node = new Node;
+  node->task = std::move(task);
+
+  auto previous = mHead.exchange(node, std::memory_order_acq_rel);
+  previous->next.store(node, std::memory_order_release);
+}
+
+bool TaskQueue::pop(TASK &task) {
+  auto next = mTail->next.load(std::memory_order_acquire);
+
+  if (next == nullptr) {
+    return false;
+  }
+
+  // next becomes the new stub once its task has been taken
+  task = std::move(next->task);
+  next->task = nullptr;
+
+  delete mTail;
+  mTail = next;
+
+  return true;
+}
+
+} // namespace Context
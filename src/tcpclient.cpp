@@ -1,13 +1,20 @@
+#include <transport-cpp/engine.h>
 #include <transport-cpp/networking/tcpclient.h>
 
+#include <cerrno>
 #include <cstring>
 #include <fcntl.h>
 #include <sys/poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 namespace Context::Devices::IO::Networking::TCP {
 
+Client::PendingRequest::PendingRequest(Engine &engine,
+                                       const RESPONSE_HANDLER &response_handler)
+    : handler(response_handler), timer(engine) {}
+
 Client::Client() : NetworkDevice(), mHost({}) {}
 
 ConnectedHost Client::getSetHostAddr() { return mHost; }
@@ -15,8 +22,18 @@ ConnectedHost Client::getSetHostAddr() { return mHost; }
 void Client::disconnect() {
   destroyHandle();
   mIsConnected = false;
+  mPeerEndpoint = {};
+
+  // a connect given up on is not reported
+  mIsConnecting = false;
+  mConnectHandler = {};
+  mConnectTimer.reset();
+
+  failInFlight({ERROR_CODE::DEVICE_NOT_READY, "Connection closed"});
 }
 
+bool Client::isConnected() const noexcept { return mIsConnected; }
+
 RETURN_CODE Client::connectToHost(const HostAddr &host,
                                   const IPVersion &ip_hint) {
   disconnect();
@@ -26,6 +43,10 @@ RETURN_CODE Client::connectToHost(const HostAddr &host,
     mHost.addr = host;
     mHost.ip_hint = ip_hint;
 
+    if (getRemoteEndpoint(mPeerEndpoint) == RETURN::NOK) {
+      logLastError("TCPClient/connectToHost");
+    }
+
     return RETURN::OK;
   }
 
@@ -36,6 +57,70 @@ RETURN_CODE Client::connectToHost(const ConnectedHost &host) {
   return connectToHost(host.addr, host.ip_hint);
 }
 
+RETURN_CODE
+Client::asyncConnectToHost(const ConnectedHost &host,
+                           const CONNECT_HANDLER &handler,
+                           const std::chrono::milliseconds &timeout) {
+  ResolvedAddr addr;
+
+  if (resolve(host.addr, addr, host.ip_hint) == RETURN::NOK) {
+    return RETURN::NOK;
+  }
+
+  return asyncConnectToHost(host, addr, handler, timeout);
+}
+
+RETURN_CODE
+Client::asyncConnectToHost(const ConnectedHost &host, const ResolvedAddr &addr,
+                           const CONNECT_HANDLER &handler,
+                           const std::chrono::milliseconds &timeout) {
+  const auto engine = getCurrentLoadedEngine();
+
+  if (engine == nullptr) {
+    setError(ERROR_CODE::INVALID_LOGIC,
+             "Asynchronous connects need the device loaded into an engine");
+    return RETURN::NOK;
+  }
+
+  disconnect();
+
+  const auto sock = socket(addr.addr.ss_family,
+                           SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+  if (sock == -1) {
+    setError(errno, "Unable to open socket");
+    return RETURN::NOK;
+  }
+
+  if (connect(sock, reinterpret_cast<const sockaddr *>(&addr.addr),
+              addr.addr_len) != 0 &&
+      errno != EINPROGRESS) {
+    setError(errno, "Unable to connect socket");
+    close(sock);
+    return RETURN::NOK;
+  }
+
+  mHost = host;
+  mConnectHandler = handler;
+  mIsConnecting = true;
+
+  expectNonBlockingHandle(SOCK_STREAM);
+  registerNewHandle(sock);
+
+  // the socket turns writable once the handshake is over, either way
+  requestWrite();
+
+  if (timeout.count() > 0) {
+    mConnectTimer = std::make_unique<WheelTimer>(*engine);
+    mConnectTimer->setCallback([this] { connectTimedOut(); });
+    (void)mConnectTimer->start(timeout);
+  }
+
+  return RETURN::OK;
+}
+
+bool Client::isConnecting() const noexcept { return mIsConnecting; }
+
 void Client::setDisconnectNotification(const DISCONNECT_NOTIFY &handler) {
   mToNotify = handler;
 }
@@ -66,9 +151,141 @@ Client::syncRequestResponse(const IODATA &data,
   return resp;
 }
 
+RETURN_CODE
+Client::setCorrelationExtractor(const CORRELATION_EXTRACTOR &extractor) {
+  if (!mInFlight.empty()) {
+    setError(ERROR_CODE::INVALID_LOGIC,
+             "Matching can not change with requests in flight");
+    return RETURN::NOK;
+  }
+
+  mCorrelationExtractor = extractor;
+  mRequestOrder.clear();
+  mSkippedReplies = 0;
+
+  return RETURN::OK;
+}
+
+RETURN_CODE Client::asyncRequest(const IODATA &data,
+                                 const RESPONSE_HANDLER &handler,
+                                 const std::chrono::milliseconds &timeout) {
+  const auto engine = getCurrentLoadedEngine();
+
+  if (engine == nullptr) {
+    setError(ERROR_CODE::INVALID_LOGIC,
+             "Asynchronous requests need the device loaded into an engine");
+    return RETURN::NOK;
+  }
+
+  if (!mIsConnected) {
+    setError(ERROR_CODE::DEVICE_NOT_READY, "Not connected");
+    return RETURN::NOK;
+  }
+
+  // one read can hold several replies, only frames separate them
+  if (!hasFraming() || hasIOBufferCallback()) {
+    setError(ERROR_CODE::INVALID_LOGIC,
+             "Asynchronous requests need framing and no IOBuffer callback");
+    return RETURN::NOK;
+  }
+
+  // an evicted request would leave its reply to whichever request is next
+  const auto limits = getSendQueueLimits();
+
+  if (limits.policy == QueuePolicy::DROP_OLDEST &&
+      (limits.max_messages != 0 || limits.max_bytes != 0)) {
+    setError(ERROR_CODE::INVALID_LOGIC,
+             "Asynchronous requests can not share a queue that drops its "
+             "oldest messages");
+    return RETURN::NOK;
+  }
+
+  CORRELATION_ID key = 0;
+
+  if (mCorrelationExtractor) {
+    const auto id = mCorrelationExtractor(data);
+
+    if (!id) {
+      setError(ERROR_CODE::INVALID_ARGUMENT,
+               "Request carries no correlation id");
+      return RETURN::NOK;
+    }
+
+    if (mInFlight.count(id.value()) != 0) {
+      setError(ERROR_CODE::INVALID_ARGUMENT,
+               "Correlation id " + std::to_string(id.value()) +
+                   " is already in flight");
+      return RETURN::NOK;
+    }
+
+    key = id.value();
+  } else {
+    key = mNextSequence++;
+  }
+
+  const auto ret = asyncSend(data);
+
+  if (ret != RETURN::OK) {
+    return ret;
+  }
+
+  auto &request = mInFlight.try_emplace(key, *engine, handler).first->second;
+
+  if (!mCorrelationExtractor) {
+    mRequestOrder.push_back(key);
+  }
+
+  if (timeout.count() > 0) {
+    request.timer.setCallback([this, key] { requestTimedOut(key); });
+    (void)request.timer.start(timeout);
+  }
+
+  return RETURN::OK;
+}
+
+std::future<Client::Response>
+Client::asyncRequest(const IODATA &data,
+                     const std::chrono::milliseconds &timeout) {
+  // handlers must be copyable, so the promise is shared
+  auto promise = std::make_shared<std::promise<Response>>();
+  auto future = promise->get_future();
+
+  const auto ret = asyncRequest(
+      data,
+      [promise](const Response &response) { promise->set_value(response); },
+      timeout);
+
+  if (ret != RETURN::OK) {
+    promise->set_value({ret, {}, getLastError()});
+  }
+
+  return future;
+}
+
+size_t Client::getInFlightCount() const noexcept { return mInFlight.size(); }
+
+size_t Client::getSkippedReplyCount() const noexcept {
+  return mSkippedReplies;
+}
+
 void Client::readyRead() {
   logDebug("TCPClient/readyReady", "incoming data");
 
+  if (mIsConnecting) {
+    finishConnect();
+    return;
+  }
+
+  if (hasIOBufferCallback()) {
+    readyReadBuffer();
+    return;
+  }
+
+  if (hasFraming()) {
+    readyReadFrames();
+    return;
+  }
+
   NetworkMessage message;
 
   auto read_resp = readIOData(message.data);
@@ -86,21 +303,165 @@ void Client::readyRead() {
     return;
   }
 
-  message.peer = mHost.addr;
+  message.peer = mPeerEndpoint;
 
   notifyCallback(message);
 }
 
+void Client::readyReadBuffer() {
+  IOBuffer buffer;
+
+  auto read_resp = readIOBuffer(buffer);
+
+  if (std::holds_alternative<SYS_ERR_CODE>(read_resp.code) &&
+      std::get<SYS_ERR_CODE>(read_resp.code) == EAGAIN) {
+    return;
+  }
+
+  if (buffer.empty()) {
+    logDebug("TCPClient/readyRead", "Peer closed connection");
+    peerDisconnected();
+    return;
+  }
+
+  notifyIOBufferCallback(buffer);
+}
+
+void Client::readyReadFrames() {
+  bool closed = false;
+
+  auto read_resp = readFrames(
+      [this](const BYTE *data, size_t size) {
+        notifyFrame(data, size);
+        return getDeviceHandle().has_value();
+      },
+      closed);
+
+  if (std::holds_alternative<ERROR_CODE>(read_resp.code) &&
+      std::get<ERROR_CODE>(read_resp.code) != ERROR_CODE::NO_ERROR) {
+    // the stream can not be resynchronised after a bad frame
+    logError("TCPClient/readyRead", read_resp.description);
+    peerDisconnected();
+    return;
+  }
+
+  if (std::holds_alternative<SYS_ERR_CODE>(read_resp.code)) {
+    logError("TCPClient/readyRead",
+             "Error reading descriptor. " + read_resp.description);
+    return;
+  }
+
+  if (closed) {
+    logDebug("TCPClient/readyRead", "Peer closed connection");
+    peerDisconnected();
+  }
+}
+
+void Client::notifyFrame(const BYTE *data, size_t size) {
+  const bool awaiting_response = !mInFlight.empty();
+
+  if (awaiting_response || hasMessageCallback()) {
+    mFrameMessage.data.assign(data, data + size);
+    mFrameMessage.peer = mPeerEndpoint;
+  }
+
+  if (awaiting_response && completeRequest(mFrameMessage.data)) {
+    return;
+  }
+
+  notifyFrameCallback(data, size);
+
+  if (hasMessageCallback()) {
+    notifyCallback(mFrameMessage);
+  }
+}
+
+void Client::readyWrite() {
+  if (mIsConnecting) {
+    finishConnect();
+    return;
+  }
+
+  NetworkDevice::readyWrite();
+}
+
 void Client::readyHangup() {
+  if (mIsConnecting) {
+    finishConnect();
+    return;
+  }
+
   logDebug("TCPClient/readyHangup", "Peer closed connection");
   peerDisconnected();
 }
 
 void Client::readyPeerDisconnect() {
+  if (mIsConnecting) {
+    finishConnect();
+    return;
+  }
+
   logDebug("TCPClient/readyPeerDisconnect", "Peer closed connection");
   peerDisconnected();
 }
 
+void Client::readyError() {
+  if (mIsConnecting) {
+    finishConnect();
+    return;
+  }
+
+  NetworkDevice::readyError();
+}
+
+void Client::finishConnect() {
+  int error = 0;
+  socklen_t error_len = sizeof(error);
+
+  if (getsockopt(getDeviceHandle().value(), SOL_SOCKET, SO_ERROR, &error,
+                 &error_len) == -1) {
+    error = errno;
+  }
+
+  if (error != 0) {
+    setError(error, "Unable to connect socket");
+    destroyHandle();
+    endConnect(RETURN::NOK);
+    return;
+  }
+
+  mIsConnected = true;
+
+  if (getRemoteEndpoint(mPeerEndpoint) == RETURN::NOK) {
+    logLastError("TCPClient/finishConnect");
+  }
+
+  // sends made while connecting were queued, this also drops write interest
+  // once the queue is empty
+  NetworkDevice::readyWrite();
+
+  endConnect(mIsConnected ? RETURN::OK : RETURN::NOK);
+}
+
+void Client::connectTimedOut() {
+  setError(ERROR_CODE::TIMEOUT, "Connect timed out");
+  destroyHandle();
+  endConnect(RETURN::NOK);
+}
+
+void Client::endConnect(RETURN_CODE code) {
+  mIsConnecting = false;
+  // may be the timer running this, it is safe to destroy from its callback
+  mConnectTimer.reset();
+
+  auto handler = std::move(mConnectHandler);
+  mConnectHandler = {};
+
+  if (handler) {
+    handler(this, code);
+  }
+}
+
 void Client::notifyOfDisconnect() {
   if (mToNotify) {
     mToNotify(this);
@@ -111,7 +472,108 @@ void Client::peerDisconnected() {
   mIsConnected = false;
 
   destroyHandle();
+  failInFlight({ERROR_CODE::DEVICE_NOT_READY, "Peer closed connection"});
   notifyOfDisconnect();
 }
 
+bool Client::completeRequest(IODATA &response) {
+  CORRELATION_ID key = 0;
+
+  if (mCorrelationExtractor) {
+    const auto id = mCorrelationExtractor(response);
+
+    if (!id) {
+      return false;
+    }
+
+    key = id.value();
+  } else {
+    if (mRequestOrder.empty()) {
+      return false;
+    }
+
+    key = mRequestOrder.front();
+    mRequestOrder.pop_front();
+  }
+
+  auto entry = mInFlight.find(key);
+
+  if (entry == mInFlight.end()) {
+    if (mCorrelationExtractor) {
+      // unsolicited, or the id of a request that has already timed out
+      return false;
+    }
+
+    // the late reply of a request that timed out
+    mSkippedReplies--;
+    return true;
+  }
+
+  auto handler = std::move(entry->second.handler);
+  mInFlight.erase(entry);
+
+  if (handler) {
+    handler({RETURN::OK, std::move(response), {ERROR_CODE::NO_ERROR, ""}});
+  }
+
+  return true;
+}
+
+void Client::requestTimedOut(CORRELATION_ID key) {
+  auto entry = mInFlight.find(key);
+
+  if (entry == mInFlight.end()) {
+    return;
+  }
+
+  auto handler = std::move(entry->second.handler);
+  mInFlight.erase(entry);
+
+  // matched in order, the key stays in mRequestOrder so the late reply is
+  // passed over rather than taken for the next request's
+  if (!mCorrelationExtractor) {
+    mSkippedReplies++;
+  }
+
+  if (handler) {
+    handler({RETURN::NOK, {}, {ERROR_CODE::TIMEOUT, "Request timed out"}});
+  }
+}
+
+void Client::failInFlight(const ERROR &error) {
+  // replies are still due while the connection is open, matched in order
+  // they have to be passed over like those of timed out requests
+  if (getDeviceHandle()) {
+    mSkippedReplies = mRequestOrder.size();
+  } else {
+    mRequestOrder.clear();
+    mSkippedReplies = 0;
+  }
+
+  if (mInFlight.empty()) {
+    return;
+  }
+
+  // handlers may send new requests, which must not land in the set failing
+  auto in_flight = std::move(mInFlight);
+  mInFlight.clear();
+
+  for (auto &[key, request] : in_flight) {
+    if (request.handler) {
+      request.handler({RETURN::NOK, {}, error});
+    }
+  }
+}
+
+void Client::engineChanged(Engine *) {
+  // the timeouts run on the old engine's wheel, which they can not outlive.
+  // The new engine is not watching for the connect to finish either
+  if (mIsConnecting) {
+    setError(ERROR_CODE::INVALID_LOGIC, "Device left its engine");
+    endConnect(RETURN::NOK);
+  }
+
+  failInFlight({ERROR_CODE::INVALID_LOGIC, "Device left its engine"});
+}
+
 } // namespace Context::Devices::IO::Networking::TCP
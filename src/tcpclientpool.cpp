@@ -0,0 +1,449 @@
+#include <transport-cpp/engine.h>
+#include <transport-cpp/networking/tcpclientpool.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <sys/socket.h>
+
+namespace Context::Devices::IO::Networking::TCP {
+
+ClientPool::Lease::Lease(ClientPool *pool, std::string key,
+                         std::unique_ptr<Client> client) noexcept
+    : mPool(pool), mKey(std::move(key)), mClient(std::move(client)) {}
+
+ClientPool::Lease::~Lease() { release(); }
+
+ClientPool::Lease &ClientPool::Lease::operator=(Lease &&other) noexcept {
+  if (this != &other) {
+    release();
+
+    mPool = other.mPool;
+    mKey = std::move(other.mKey);
+    mClient = std::move(other.mClient);
+  }
+
+  return *this;
+}
+
+Client *ClientPool::Lease::get() const noexcept { return mClient.get(); }
+
+Client *ClientPool::Lease::operator->() const noexcept {
+  return mClient.get();
+}
+
+Client &ClientPool::Lease::operator*() const noexcept { return *mClient; }
+
+ClientPool::Lease::operator bool() const noexcept {
+  return static_cast<bool>(mClient);
+}
+
+void ClientPool::Lease::release() {
+  if (mClient && mPool != nullptr) {
+    mPool->release(mKey, std::move(mClient), false);
+  }
+}
+
+void ClientPool::Lease::discard() {
+  if (mClient && mPool != nullptr) {
+    mPool->release(mKey, std::move(mClient), true);
+  }
+}
+
+ClientPool::IdleClient::IdleClient(Engine &engine,
+                                   std::unique_ptr<Client> idle_client)
+    : client(std::move(idle_client)), idle_timer(engine) {}
+
+ClientPool::ClientPool(Engine &engine) : mEngine(engine) {}
+
+ClientPool::~ClientPool() { mHosts.clear(); }
+
+RETURN_CODE ClientPool::acquire(const ConnectedHost &host,
+                                const LEASE_HANDLER &handler) {
+  const auto key = keyOf(host);
+  auto &pool = hostPool(host);
+
+  while (!pool.idle.empty()) {
+    auto idle = std::move(pool.idle.back());
+    pool.idle.pop_back();
+
+    if (!isHealthy(*idle->client)) {
+      mStats.health_check_failures++;
+      continue;
+    }
+
+    mStats.hits++;
+    pool.leased++;
+
+    idle->client->setDisconnectNotification({});
+    replenish(key, pool);
+
+    handler(Lease(this, key, std::move(idle->client)));
+
+    return RETURN::OK;
+  }
+
+  mStats.misses++;
+
+  if (mLimits.max_per_host != 0 &&
+      pool.leased + pool.connecting.size() >= mLimits.max_per_host) {
+    mLastError = {Device::ERROR_CODE::QUEUE_FULL,
+                  "Connection limit for " + host.addr.ip + ":" +
+                      std::to_string(host.addr.port) + " reached"};
+    return RETURN::FULL;
+  }
+
+  return connect(key, pool, handler);
+}
+
+RETURN_CODE ClientPool::warm(const ConnectedHost &host) {
+  const auto key = keyOf(host);
+  auto &pool = hostPool(host);
+
+  while (pool.idle.size() + pendingIdle(pool) < mLimits.min_idle &&
+         (mLimits.max_per_host == 0 ||
+          pool.idle.size() + pool.connecting.size() + pool.leased <
+              mLimits.max_per_host)) {
+    if (connect(key, pool, {}) == RETURN::NOK) {
+      replenish(key, pool);
+      return RETURN::NOK;
+    }
+  }
+
+  return RETURN::OK;
+}
+
+void ClientPool::setLimits(const Limits &limits) {
+  mLimits = limits;
+  mLimits.reconnect_min =
+      std::max(mLimits.reconnect_min, std::chrono::milliseconds{1});
+  mLimits.reconnect_max =
+      std::max(mLimits.reconnect_max, mLimits.reconnect_min);
+}
+
+ClientPool::Limits ClientPool::getLimits() const noexcept { return mLimits; }
+
+ClientPool::Stats ClientPool::getStats() const noexcept { return mStats; }
+
+void ClientPool::resetStats() noexcept { mStats = {}; }
+
+double ClientPool::getHitRatio() const noexcept {
+  const auto acquires = mStats.hits + mStats.misses;
+
+  if (acquires == 0) {
+    return 0;
+  }
+
+  return static_cast<double>(mStats.hits) / static_cast<double>(acquires);
+}
+
+std::chrono::microseconds
+ClientPool::getAverageConnectTime() const noexcept {
+  if (mStats.connects == 0) {
+    return std::chrono::microseconds{0};
+  }
+
+  return mStats.connect_time_total / mStats.connects;
+}
+
+size_t ClientPool::getIdleCount(const ConnectedHost &host) const {
+  const auto pool = mHosts.find(keyOf(host));
+
+  return pool == mHosts.end() ? 0 : pool->second.idle.size();
+}
+
+size_t ClientPool::getLeasedCount(const ConnectedHost &host) const {
+  const auto pool = mHosts.find(keyOf(host));
+
+  return pool == mHosts.end() ? 0 : pool->second.leased;
+}
+
+size_t ClientPool::getConnectingCount(const ConnectedHost &host) const {
+  const auto pool = mHosts.find(keyOf(host));
+
+  return pool == mHosts.end() ? 0 : pool->second.connecting.size();
+}
+
+void ClientPool::clear() {
+  for (auto &[key, pool] : mHosts) {
+    pool.idle.clear();
+    pool.reconnect_timer.reset();
+
+    pool.connecting.erase(
+        std::remove_if(pool.connecting.begin(), pool.connecting.end(),
+                       [](const auto &entry) { return !entry->waiter; }),
+        pool.connecting.end());
+  }
+}
+
+Device::ERROR ClientPool::getLastError() const noexcept { return mLastError; }
+
+std::string ClientPool::keyOf(const ConnectedHost &host) {
+  return host.addr.ip + "|" + std::to_string(host.addr.port) + "|" +
+         std::to_string(static_cast<int>(host.ip_hint));
+}
+
+ClientPool::HostPool &ClientPool::hostPool(const ConnectedHost &host) {
+  auto &pool = mHosts[keyOf(host)];
+  pool.host = host;
+
+  return pool;
+}
+
+RETURN_CODE ClientPool::connect(const std::string &key, HostPool &pool,
+                                const LEASE_HANDLER &waiter) {
+  auto client = std::make_unique<Client>();
+
+  if (mEngine.registerDevice(*client) == RETURN::NOK) {
+    mLastError = {Device::ERROR_CODE::GENERAL_ERROR,
+                  "Unable to register connection with the engine"};
+    return RETURN::NOK;
+  }
+
+  ResolvedAddr addr;
+  const auto started = std::chrono::steady_clock::now();
+
+  if (resolve(*client, pool.host, addr) == RETURN::NOK ||
+      client->asyncConnectToHost(
+          pool.host, addr,
+          [this, key](Client *connected, RETURN_CODE code) {
+            connectFinished(key, connected, code);
+          },
+          mLimits.connect_timeout) == RETURN::NOK) {
+    mStats.connect_failures++;
+    mLastError = client->getLastError();
+    return RETURN::NOK;
+  }
+
+  pool.connecting.push_back(std::make_unique<ConnectingClient>(
+      ConnectingClient{std::move(client), waiter, started}));
+
+  return RETURN::OK;
+}
+
+void ClientPool::connectFinished(const std::string &key,
+                                 const Client *client, RETURN_CODE code) {
+  auto &pool = mHosts[key];
+
+  const auto entry =
+      std::find_if(pool.connecting.begin(), pool.connecting.end(),
+                   [client](const auto &connecting) {
+                     return connecting->client.get() == client;
+                   });
+
+  if (entry == pool.connecting.end()) {
+    return;
+  }
+
+  auto connecting = std::move(*entry);
+  pool.connecting.erase(entry);
+
+  if (code != RETURN::OK) {
+    mStats.connect_failures++;
+    mLastError = connecting->client->getLastError();
+
+    // the name may point somewhere else by now
+    mAddrCache.invalidate(pool.host.addr);
+
+    // called from inside the client, it can not be destroyed right away
+    dispose(std::move(connecting->client));
+    replenish(key, pool);
+
+    if (connecting->waiter) {
+      connecting->waiter({});
+    }
+
+    return;
+  }
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - connecting->started);
+
+  mStats.connects++;
+  mStats.connect_time_total += elapsed;
+  mStats.last_connect_time = elapsed;
+
+  if (connecting->waiter) {
+    pool.leased++;
+    connecting->waiter(Lease(this, key, std::move(connecting->client)));
+    return;
+  }
+
+  // the host answers again, the next failure backs off from the start
+  pool.backoff = std::chrono::milliseconds{0};
+  addIdle(key, pool, std::move(connecting->client));
+}
+
+RETURN_CODE ClientPool::resolve(Client &client, const ConnectedHost &host,
+                                ResolvedAddr &addr) {
+  if (const auto cached = mAddrCache.find(host.addr, host.ip_hint);
+      cached != nullptr) {
+    addr = *cached;
+    return RETURN::OK;
+  }
+
+  if (client.resolve(host.addr, addr, host.ip_hint) == RETURN::NOK) {
+    return RETURN::NOK;
+  }
+
+  mAddrCache.insert(host.addr, host.ip_hint, addr);
+
+  return RETURN::OK;
+}
+
+size_t ClientPool::pendingIdle(const HostPool &pool) noexcept {
+  return static_cast<size_t>(
+      std::count_if(pool.connecting.begin(), pool.connecting.end(),
+                    [](const auto &entry) { return !entry->waiter; }));
+}
+
+bool ClientPool::isHealthy(const Client &client) {
+  const auto handle = client.getDeviceHandle();
+
+  if (!client.isConnected() || !handle) {
+    return false;
+  }
+
+  // the close (or stray data) may have arrived since the engine last looked
+  char byte;
+  const auto peeked =
+      recv(handle.value(), &byte, sizeof(byte), MSG_PEEK | MSG_DONTWAIT);
+
+  return peeked == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+void ClientPool::addIdle(const std::string &key, HostPool &pool,
+                         std::unique_ptr<Client> client) {
+  const auto raw = client.get();
+
+  raw->setDisconnectNotification(
+      [this, key](Client *closed) { idleDisconnected(key, closed); });
+
+  pool.idle.push_back(
+      std::make_unique<IdleClient>(mEngine, std::move(client)));
+
+  if (mLimits.idle_timeout.count() > 0) {
+    auto &timer = pool.idle.back()->idle_timer;
+
+    timer.setCallback([this, key, raw] { idleExpired(key, raw); });
+    (void)timer.start(mLimits.idle_timeout);
+  }
+}
+
+std::unique_ptr<Client> ClientPool::takeIdle(HostPool &pool,
+                                             const Client *client) {
+  const auto idle =
+      std::find_if(pool.idle.begin(), pool.idle.end(),
+                   [client](const auto &entry) {
+                     return entry->client.get() == client;
+                   });
+
+  if (idle == pool.idle.end()) {
+    return nullptr;
+  }
+
+  auto taken = std::move((*idle)->client);
+  pool.idle.erase(idle);
+
+  return taken;
+}
+
+void ClientPool::release(const std::string &key,
+                         std::unique_ptr<Client> client, bool discard) {
+  auto &pool = mHosts[key];
+
+  if (pool.leased > 0) {
+    pool.leased--;
+  }
+
+  // requests still in flight would answer into the next lease
+  if (discard || !client->isConnected() || client->getInFlightCount() != 0 ||
+      client->getSkippedReplyCount() != 0) {
+    dispose(std::move(client));
+    replenish(key, pool);
+    return;
+  }
+
+  client->setGenericNetworkCallback({});
+  client->setBatchNetworkCallback({});
+  client->setIODataCallback({});
+  client->setIOBufferCallback({});
+  client->setFrameCallback({});
+  client->clearFraming();
+  (void)client->setCorrelationExtractor({});
+  client->setHighWatermarkCallback({});
+  client->setLowWatermarkCallback({});
+
+  addIdle(key, pool, std::move(client));
+}
+
+void ClientPool::idleExpired(const std::string &key, const Client *client) {
+  auto &pool = mHosts[key];
+
+  if (pool.idle.size() <= mLimits.min_idle) {
+    // kept warm, look again after another timeout
+    for (auto &idle : pool.idle) {
+      if (idle->client.get() == client) {
+        (void)idle->idle_timer.restart();
+      }
+    }
+
+    return;
+  }
+
+  if (takeIdle(pool, client)) {
+    mStats.idle_evictions++;
+  }
+}
+
+void ClientPool::idleDisconnected(const std::string &key,
+                                  const Client *client) {
+  auto &pool = mHosts[key];
+
+  // called from inside the client, it can not be destroyed right away
+  dispose(takeIdle(pool, client));
+  replenish(key, pool);
+}
+
+void ClientPool::replenish(const std::string &key, HostPool &pool) {
+  if (pool.idle.size() + pendingIdle(pool) >= mLimits.min_idle ||
+      (pool.reconnect_timer && pool.reconnect_timer->isRunning())) {
+    return;
+  }
+
+  if (!pool.reconnect_timer) {
+    pool.reconnect_timer = std::make_unique<WheelTimer>(mEngine);
+    pool.reconnect_timer->setCallback([this, key] { reconnect(key); });
+  }
+
+  pool.backoff = std::clamp(pool.backoff, mLimits.reconnect_min,
+                            mLimits.reconnect_max);
+
+  (void)pool.reconnect_timer->start(pool.backoff);
+}
+
+void ClientPool::reconnect(const std::string &key) {
+  auto &pool = mHosts[key];
+
+  mStats.reconnect_attempts++;
+
+  // doubled first, a failing connect starts the timer again with it. The
+  // first one to get through resets it
+  pool.backoff = std::min(pool.backoff * 2, mLimits.reconnect_max);
+
+  (void)warm(pool.host);
+}
+
+void ClientPool::dispose(std::unique_ptr<Client> client) {
+  if (!client) {
+    return;
+  }
+
+  client->setDisconnectNotification({});
+
+  // tasks must be copyable, the holder keeps the client alive until it runs
+  auto holder = std::make_shared<std::unique_ptr<Client>>(std::move(client));
+
+  (void)mEngine.post([holder] { holder->reset(); });
+}
+
+} // namespace Context::Devices::IO::Networking::TCP
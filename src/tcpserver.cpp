@@ -1,6 +1,7 @@
 #include <transport-cpp/engine.h>
 #include <transport-cpp/networking/tcpserver.h>
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cstring>
 #include <fcntl.h>
@@ -25,8 +26,22 @@ void Acceptor::setNewPeerHandler(NEW_PEER_HANDLER handler) noexcept {
   mHandleNewPeer = handler;
 }
 
+void Acceptor::distributePeers(EnginePool *pool,
+                               EnginePool::Placement placement) noexcept {
+  mPeerPool = pool;
+  mPeerPlacement = placement;
+}
+
 bool Acceptor::isBound() const noexcept { return mIsBound; }
 
+void Acceptor::setAcceptBatchSize(size_t batch_size) noexcept {
+  mAcceptBatchSize = std::max<size_t>(batch_size, 1);
+}
+
+size_t Acceptor::getAcceptBatchSize() const noexcept {
+  return mAcceptBatchSize;
+}
+
 RETURN_CODE Acceptor::bind(PORT port, IPVersion ip_hint) noexcept {
   HostAddr addr;
 
@@ -79,55 +94,60 @@ void Acceptor::listen() {
 }
 
 void Acceptor::readyRead() {
-  int peer;
+  const auto sock = getDeviceHandle().value();
 
-  struct sockaddr_storage their_addr;
+  for (size_t accepted = 0; accepted < mAcceptBatchSize; accepted++) {
+    sockaddr_storage their_addr;
+    socklen_t addr_size = sizeof(their_addr);
 
-  socklen_t addr_size = sizeof(their_addr);
-  peer = accept(getDeviceHandle().value(),
-                reinterpret_cast<struct sockaddr *>(&their_addr), &addr_size);
+    const auto peer =
+        accept4(sock, reinterpret_cast<sockaddr *>(&their_addr), &addr_size,
+                SOCK_NONBLOCK | SOCK_CLOEXEC);
 
-  char ip[INET6_ADDRSTRLEN];
-  auto maxlen = sizeof(ip);
-  PORT port;
+    if (peer != -1) {
+      acceptPeer(peer, their_addr);
 
-  switch (reinterpret_cast<struct sockaddr *>(&their_addr)->sa_family) {
-  case AF_INET:
-    inet_ntop(
-        AF_INET,
-        &((reinterpret_cast<struct sockaddr_in *>(&their_addr))->sin_addr), ip,
-        static_cast<socklen_t>(maxlen));
-    port =
-        ntohs((reinterpret_cast<struct sockaddr_in *>(&their_addr))->sin_port);
-    break;
+      // a peer handler may have closed the acceptor
+      if (!getDeviceHandle()) {
+        return;
+      }
 
-  case AF_INET6:
-    inet_ntop(
-        AF_INET6,
-        &((reinterpret_cast<struct sockaddr_in6 *>(&their_addr))->sin6_addr),
-        ip, static_cast<socklen_t>(maxlen));
-    port = ntohs(
-        (reinterpret_cast<struct sockaddr_in6 *>(&their_addr))->sin6_port);
-    break;
+      continue;
+    }
 
-  default:
-    strncpy(ip, "Unknown AF", maxlen);
-    port = 0;
+    switch (errno) {
+    case EINTR:
+    case ECONNABORTED:
+      // the connection went away before it was taken, try the next one
+      continue;
+
+    case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+    case EWOULDBLOCK:
+#endif
+      return;
+
+    default:
+      // e.g. out of descriptors. The backlog is left for the next wakeup
+      logError("Acceptor/readyRead",
+               "Unable to accept connection: " + std::string(strerror(errno)));
+      return;
+    }
   }
+}
 
-  HostAddr peerAddr;
-
-  peerAddr.ip = ip;
-  peerAddr.port = port;
+void Acceptor::acceptPeer(DEVICE_HANDLE_ handle,
+                          const sockaddr_storage &addr) {
+  auto tcpPeer = std::unique_ptr<Peer>(new Peer(handle, Endpoint(addr)));
 
-  auto peer_raw = new Peer(peer, peerAddr);
-  auto tcpPeer = std::unique_ptr<Peer>(peer_raw);
+  if (mPeerPool != nullptr) {
+    dispatchToPool(std::move(tcpPeer));
+    return;
+  }
 
   registerChildDevice(tcpPeer.get());
 
   notifyNewPeer(std::move(tcpPeer));
-
-  listen();
 }
 
 void Acceptor::readyHangup() {
@@ -142,6 +162,25 @@ void Acceptor::notifyNewPeer(std::unique_ptr<Peer> new_peer) const {
   }
 }
 
+void Acceptor::dispatchToPool(std::unique_ptr<Peer> new_peer) {
+  const auto index = mPeerPool->selectEngine(mPeerPlacement);
+
+  // tasks must be copyable, the holder keeps the peer alive until it runs
+  auto holder = std::make_shared<std::unique_ptr<Peer>>(std::move(new_peer));
+  auto handler = mHandleNewPeer;
+
+  // tasks run in order, so the peer is registered before the handler sees it
+  if (mPeerPool->registerDevice(**holder, index) == RETURN::NOK ||
+      mPeerPool->post(index, [holder, handler] {
+        if (handler) {
+          handler(std::move(*holder));
+        }
+      }) == RETURN::NOK) {
+    logError("Acceptor/dispatchToPool",
+             "Unable to hand new peer over to the engine pool");
+  }
+}
+
 void Peer::setRequestHandler(NEW_REQUEST_HANDLER handler) noexcept {
   mRequestHandler = handler;
 }
@@ -150,8 +189,10 @@ void Peer::setDisconnectHandler(PEER_DISCONNECT_HANDLER handler) noexcept {
   mDisconnectHandler = handler;
 }
 
-Peer::Peer(DEVICE_HANDLE_ handle, const HostAddr &peer_addr) noexcept
-    : NetworkDevice(), mPeerAddr(peer_addr) {
+Peer::Peer(DEVICE_HANDLE_ handle, const Endpoint &peer_endpoint) noexcept
+    : NetworkDevice(), mPeerEndpoint(peer_endpoint) {
+  // accepted with SOCK_NONBLOCK
+  expectNonBlockingHandle(SOCK_STREAM);
   registerNewHandle(handle);
   mIsConnected = true;
 }
@@ -159,6 +200,16 @@ Peer::Peer(DEVICE_HANDLE_ handle, const HostAddr &peer_addr) noexcept
 void Peer::readyRead() {
   logDebug("TCPPeer\readyReady", "incoming data");
 
+  if (hasIOBufferCallback()) {
+    readyReadBuffer();
+    return;
+  }
+
+  if (hasFraming()) {
+    readyReadFrames();
+    return;
+  }
+
   NetworkMessage message;
 
   auto read_resp = readIOData(message.data);
@@ -176,11 +227,73 @@ void Peer::readyRead() {
     return;
   }
 
-  message.peer = mPeerAddr;
+  message.peer = mPeerEndpoint;
 
   notifyServerHandler(message);
 }
 
+void Peer::readyReadBuffer() {
+  IOBuffer buffer;
+
+  auto read_resp = readIOBuffer(buffer);
+
+  if (std::holds_alternative<SYS_ERR_CODE>(read_resp.code) &&
+      std::get<SYS_ERR_CODE>(read_resp.code) == EAGAIN) {
+    return;
+  }
+
+  if (buffer.empty()) {
+    logDebug("TCPPeer/readyRead", "Peer closed connection");
+    peerDisconnected();
+    return;
+  }
+
+  notifyIOBufferCallback(buffer);
+}
+
+void Peer::readyReadFrames() {
+  bool closed = false;
+
+  auto read_resp = readFrames(
+      [this](const BYTE *data, size_t size) {
+        notifyFrame(data, size);
+        return getDeviceHandle().has_value();
+      },
+      closed);
+
+  if (std::holds_alternative<ERROR_CODE>(read_resp.code) &&
+      std::get<ERROR_CODE>(read_resp.code) != ERROR_CODE::NO_ERROR) {
+    // the stream can not be resynchronised after a bad frame
+    logError("TCPPeer/readyRead", read_resp.description);
+    peerDisconnected();
+    return;
+  }
+
+  if (std::holds_alternative<SYS_ERR_CODE>(read_resp.code)) {
+    logError("TCPPeer/readyRead",
+             "Error reading descriptor. " + read_resp.description);
+    return;
+  }
+
+  if (closed) {
+    logDebug("TCPPeer/readyRead", "Peer closed connection");
+    peerDisconnected();
+  }
+}
+
+void Peer::notifyFrame(const BYTE *data, size_t size) {
+  notifyFrameCallback(data, size);
+
+  if (!mRequestHandler && !hasMessageCallback()) {
+    return;
+  }
+
+  mFrameMessage.data.assign(data, data + size);
+  mFrameMessage.peer = mPeerEndpoint;
+
+  notifyServerHandler(mFrameMessage);
+}
+
 void Peer::readyHangup() { peerDisconnected(); }
 
 void Peer::readyPeerDisconnect() { peerDisconnected(); }
@@ -204,7 +317,7 @@ void Peer::notifyServerHandler(const NetworkMessage &request) {
 
   auto response = mRequestHandler(request);
 
-  if (response->empty()) {
+  if (!response || response->empty()) {
     logDebug("TCPPeer/notifyserverhandler", "No response provided");
     return;
   }
@@ -232,6 +345,10 @@ void Peer::notifyServerHandler(const NetworkMessage &request) {
   }
 }
 
-HostAddr Peer::getPeerAddr() const noexcept { return mPeerAddr; }
+HostAddr Peer::getPeerAddr() const { return mPeerEndpoint.toHostAddr(); }
+
+const Endpoint &Peer::getPeerEndpoint() const noexcept {
+  return mPeerEndpoint;
+}
 
 } // namespace Context::Devices::IO::Networking::TCP::Server
@@ -5,25 +5,19 @@
 #include <stdexcept>
 #include <transport-cpp/timer.h>
 
-#include <cmath>
+#include <algorithm>
 #include <cstring>
 #include <fcntl.h>
 #include <sys/timerfd.h>
 #include <unistd.h>
 
 timespec nsToTimespec(std::chrono::nanoseconds ns) {
-  static constexpr double secToNsec = 1000000000.0;
+  static constexpr std::chrono::nanoseconds::rep secToNsec = 1000000000;
 
+  // integer maths, doubles lose nanoseconds past ~104 days
   timespec ts;
-
-  auto nsDbl = static_cast<double>(ns.count());
-  auto fractionalSec = nsDbl / secToNsec;
-
-  double seconds;
-
-  ts.tv_nsec = static_cast<decltype(ts.tv_nsec)>(
-      std::modf(fractionalSec, &seconds) * secToNsec);
-  ts.tv_sec = static_cast<decltype(ts.tv_sec)>(seconds);
+  ts.tv_sec = static_cast<decltype(ts.tv_sec)>(ns.count() / secToNsec);
+  ts.tv_nsec = static_cast<decltype(ts.tv_nsec)>(ns.count() % secToNsec);
 
   return ts;
 }
@@ -32,7 +26,7 @@ namespace Context {
 
 Timer::Timer()
     : Device(), mIsRunning(false),
-      mSetDuration(std::chrono::milliseconds::max()) {
+      mSetDuration(std::chrono::nanoseconds::max()) {
   auto tmrfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
 
   if (tmrfd < 0) {
@@ -88,43 +82,77 @@ RETURN_CODE Timer::resume() noexcept {
     return RETURN::NOK;
   }
 
-  return start(mSetDuration);
+  if (mSetDeadline) {
+    return startAt(mSetDeadline.value(), mSetDuration);
+  }
+
+  return start(mSetDuration, mMode);
 }
 
-RETURN_CODE Timer::start(const std::chrono::milliseconds &duration) noexcept {
+RETURN_CODE Timer::start(const std::chrono::nanoseconds &duration,
+                         Mode mode) noexcept {
+  if (duration.count() < 0) {
+    setError(ERROR_CODE::INVALID_ARGUMENT,
+             "Cannot start timer with a negative duration");
+    return RETURN::NOK;
+  }
+
   if (isRunning()) {
     stop();
   }
 
   mSetDuration = duration;
-  auto tmrfd = getDeviceHandle().value();
-
-  itimerspec tmr;
+  mSetDeadline.reset();
+  mMode = mode;
 
   // Theres an accuracy of about 1000ns on the timers.
 
-  // When, in the future, will the first trigger happen (must be non zero)
-  //    tmr.it_value.tv_nsec = 10000000000;
-  //    tmr.it_value.tv_sec = 0;
+  // When, in the future, will the first trigger happen (must be non zero,
+  // zero disarms the timer)
+  auto value = nsToTimespec(std::max(duration, std::chrono::nanoseconds(1)));
 
   // When, after the first trigger, will the fd continue to trigger. if both
-  // values are 0, after the initial trigger
-  // the fd will no longer trigger when polled, it will be a dead fd
-  //    tmr.it_interval.tv_sec = 0;
-  //    tmr.it_interval.tv_nsec = 10000000000; // limit appears to be 3000ns,
-  //    that could be a limitation,
-  // of my setup here, but poll wont return any faster than 3000ns, lower values
-  // will mean a non '1' value in the 'buf' below, indicating that multiple
-  // intervals have occured since poll returned.
+  // values are 0, after the initial trigger the timer is spent
+  auto interval = (mode == Mode::PERIODIC) ? value : timespec{0, 0};
 
-  auto ts = nsToTimespec(duration);
+  return arm(value, interval, 0);
+}
 
-  tmr.it_value = ts;
-  tmr.it_interval = ts;
+RETURN_CODE
+Timer::startAt(const std::chrono::steady_clock::time_point &deadline,
+               const std::chrono::nanoseconds &interval) noexcept {
+  if (interval.count() < 0) {
+    setError(ERROR_CODE::INVALID_ARGUMENT,
+             "Cannot start timer with a negative interval");
+    return RETURN::NOK;
+  }
+
+  if (isRunning()) {
+    stop();
+  }
+
+  mSetDuration = interval;
+  mSetDeadline = deadline;
+  mMode = (interval.count() == 0) ? Mode::ONE_SHOT : Mode::PERIODIC;
+
+  // steady_clock is CLOCK_MONOTONIC, the clock the timerfd was created on.
+  // A deadline already in the past expires straight away
+  auto value = nsToTimespec(std::max(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          deadline.time_since_epoch()),
+      std::chrono::nanoseconds(1)));
+
+  return arm(value, nsToTimespec(interval), TFD_TIMER_ABSTIME);
+}
 
-  // tv_nsec cannot exceed 1s
+RETURN_CODE Timer::arm(const timespec &value, const timespec &interval,
+                       int flags) noexcept {
+  itimerspec tmr;
+  tmr.it_value = value;
+  tmr.it_interval = interval;
 
-  auto response = timerfd_settime(tmrfd, 0, &tmr, nullptr);
+  auto response =
+      timerfd_settime(getDeviceHandle().value(), flags, &tmr, nullptr);
 
   if (response < 0) {
     setError(errno, "Unable to start timer");
@@ -137,20 +165,38 @@ RETURN_CODE Timer::start(const std::chrono::milliseconds &duration) noexcept {
 }
 
 void Timer::setCallback(std::function<void(void)> callback) {
-  mCallback = callback;
+  if (!callback) {
+    mCallback = nullptr;
+    return;
+  }
+
+  mCallback = [callback = std::move(callback)](uint64_t) { callback(); };
+}
+
+void Timer::setExpiryCallback(EXPIRY_CALLBACK callback) {
+  mCallback = std::move(callback);
 }
 
 bool Timer::isRunning() const noexcept { return mIsRunning; }
 
+Timer::Mode Timer::getMode() const noexcept { return mMode; }
+
 void Timer::readyRead() {
-  static thread_local char buffer[8];
+  uint64_t expirations = 0;
+
+  // timer needs to be read otherwise time will not be reset and will always
+  // be 'valid' causing poll to return
+  if (read(getDeviceHandle().value(), &expirations, sizeof(expirations)) !=
+      sizeof(expirations)) {
+    return;
+  }
 
-  read(getDeviceHandle().value(), buffer,
-       sizeof(buffer)); // timer needs to be read otherwise
-  // time will not be reset and will always be 'valid' causing poll to return
+  if (mMode == Mode::ONE_SHOT) {
+    mIsRunning = false;
+  }
 
   if (mCallback) {
-    mCallback();
+    mCallback(expirations);
   }
 }
 
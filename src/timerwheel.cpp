@@ -0,0 +1,344 @@
+#include <transport-cpp/timerwheel.h>
+
+#include <transport-cpp/engine.h>
+
+#include <algorithm>
+#include <limits>
+
+// furthest a timer can be scheduled ahead of the wheel, in ticks
+static constexpr uint64_t MAX_DELTA = std::numeric_limits<uint32_t>::max();
+
+namespace Context {
+
+TimerWheel::TimerWheel() : mEpoch(std::chrono::steady_clock::now()) {
+  for (auto &level : mLevels) {
+    for (auto &slot : level.slots) {
+      slot.prev = &slot;
+      slot.next = &slot;
+    }
+  }
+}
+
+TimerWheel::~TimerWheel() {
+  // leave anything still scheduled stopped and unlinked
+  for (auto &level : mLevels) {
+    for (auto &slot : level.slots) {
+      while (slot.next != &slot) {
+        auto timer = static_cast<WheelTimer *>(slot.next);
+
+        unlink(*timer);
+        timer->mSlot = WheelTimer::NO_SLOT;
+        timer->mIsRunning = false;
+      }
+    }
+  }
+}
+
+size_t TimerWheel::size() const noexcept { return mCount; }
+
+int TimerWheel::timeoutUpto(int timeout_ms) const noexcept {
+  if (mCount == 0) {
+    return timeout_ms;
+  }
+
+  const auto next = nextExpiry();
+  const auto current = now();
+
+  uint64_t wait = (next > current) ? next - current : 0;
+  wait = std::min<uint64_t>(wait, std::numeric_limits<int>::max());
+
+  if (timeout_ms < 0) {
+    return static_cast<int>(wait);
+  }
+
+  return std::min(timeout_ms, static_cast<int>(wait));
+}
+
+void TimerWheel::advance() {
+  const auto target = now();
+
+  if (mCount == 0) {
+    mCurrent = std::max(mCurrent, target);
+    return;
+  }
+
+  while (mCurrent < target) {
+    // jump straight to the next occupied slot, or the end of this rotation
+    // where the upper levels cascade down
+    const auto rotation = mCurrent & ~static_cast<uint64_t>(SLOTS - 1);
+    auto next = std::min(target, rotation + SLOTS);
+
+    const auto from = static_cast<unsigned>((mCurrent + 1) & (SLOTS - 1));
+
+    if (from != 0) {
+      const auto index = nextOccupied(mLevels[0].occupied, from);
+
+      if (index >= static_cast<int>(from)) {
+        next = std::min(next, rotation + static_cast<uint64_t>(index));
+      }
+    }
+
+    mCurrent = next;
+
+    if ((mCurrent & (SLOTS - 1)) == 0) {
+      for (unsigned level = 1; level < LEVELS; level++) {
+        cascade(level);
+
+        if (((mCurrent >> (SLOT_BITS * level)) & (SLOTS - 1)) != 0) {
+          break;
+        }
+      }
+    }
+
+    expire(mLevels[0].slots[mCurrent & (SLOTS - 1)]);
+  }
+}
+
+uint64_t TimerWheel::now() const noexcept {
+  return static_cast<uint64_t>(std::chrono::duration_cast<TICK>(
+                                   std::chrono::steady_clock::now() - mEpoch)
+                                   .count());
+}
+
+uint64_t TimerWheel::expiryAfter(const TICK &duration) const noexcept {
+  const auto ticks = std::min<uint64_t>(
+      static_cast<uint64_t>(std::max<TICK::rep>(duration.count(), 0)),
+      MAX_DELTA);
+
+  // round up so a timer never fires before its full duration has passed
+  const auto expiry = static_cast<uint64_t>(
+      std::chrono::ceil<TICK>(std::chrono::steady_clock::now() - mEpoch +
+                              TICK(ticks))
+          .count());
+
+  return std::max(expiry, mCurrent + 1);
+}
+
+uint64_t TimerWheel::nextExpiry() const noexcept {
+  auto next = std::numeric_limits<uint64_t>::max();
+
+  for (unsigned level = 0; level < LEVELS; level++) {
+    const auto shift = SLOT_BITS * level;
+    const auto position = mCurrent >> shift;
+
+    const auto index = nextOccupied(
+        mLevels[level].occupied,
+        static_cast<unsigned>((position + 1) & (SLOTS - 1)));
+
+    if (index < 0) {
+      continue;
+    }
+
+    auto distance = (static_cast<uint64_t>(index) - position) & (SLOTS - 1);
+
+    if (distance == 0 && level > 0) {
+      distance = SLOTS;
+    }
+
+    // upper levels only give the tick their slot cascades at, which is
+    // never later than the timers within it
+    next = std::min(next, (position + distance) << shift);
+  }
+
+  return next;
+}
+
+void TimerWheel::schedule(WheelTimer &timer) noexcept {
+  auto delta = (timer.mExpiry > mCurrent) ? timer.mExpiry - mCurrent : 0;
+
+  if (delta > MAX_DELTA) {
+    delta = MAX_DELTA;
+    timer.mExpiry = mCurrent + delta;
+  }
+
+  unsigned level = 0;
+
+  while (level < LEVELS - 1 &&
+         delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+    level++;
+  }
+
+  const auto index = static_cast<unsigned>(
+      (timer.mExpiry >> (SLOT_BITS * level)) & (SLOTS - 1));
+
+  append(mLevels[level].slots[index], timer);
+  mLevels[level].occupied[index / WORD_BITS] |= uint64_t(1)
+                                                << (index % WORD_BITS);
+
+  timer.mSlot = static_cast<uint16_t>(level * SLOTS + index);
+  mCount++;
+}
+
+void TimerWheel::unschedule(WheelTimer &timer) noexcept {
+  if (timer.prev == nullptr) {
+    return;
+  }
+
+  unlink(timer);
+  mCount--;
+
+  // timers already taken out of their slot for expiry have no bit to clear
+  if (timer.mSlot == WheelTimer::NO_SLOT) {
+    return;
+  }
+
+  const auto level = timer.mSlot / SLOTS;
+  const auto index = timer.mSlot % SLOTS;
+  const auto &slot = mLevels[level].slots[index];
+
+  if (slot.next == &slot) {
+    mLevels[level].occupied[index / WORD_BITS] &=
+        ~(uint64_t(1) << (index % WORD_BITS));
+  }
+
+  timer.mSlot = WheelTimer::NO_SLOT;
+}
+
+void TimerWheel::cascade(unsigned level) {
+  const auto index = static_cast<unsigned>(
+      (mCurrent >> (SLOT_BITS * level)) & (SLOTS - 1));
+  auto &slot = mLevels[level].slots[index];
+
+  while (slot.next != &slot) {
+    auto timer = static_cast<WheelTimer *>(slot.next);
+
+    unlink(*timer);
+    mCount--;
+    schedule(*timer);
+  }
+
+  mLevels[level].occupied[index / WORD_BITS] &=
+      ~(uint64_t(1) << (index % WORD_BITS));
+}
+
+void TimerWheel::expire(Link &slot) {
+  if (slot.next == &slot) {
+    return;
+  }
+
+  // move the slot aside first, callbacks are free to start and stop timers
+  // (including ones still waiting in here) while it is walked
+  Link pending;
+  pending.next = slot.next;
+  pending.prev = slot.prev;
+  pending.next->prev = &pending;
+  pending.prev->next = &pending;
+
+  slot.next = &slot;
+  slot.prev = &slot;
+
+  const auto index = static_cast<unsigned>(mCurrent & (SLOTS - 1));
+  mLevels[0].occupied[index / WORD_BITS] &=
+      ~(uint64_t(1) << (index % WORD_BITS));
+
+  for (auto link = pending.next; link != &pending; link = link->next) {
+    static_cast<WheelTimer *>(link)->mSlot = WheelTimer::NO_SLOT;
+  }
+
+  while (pending.next != &pending) {
+    auto timer = static_cast<WheelTimer *>(pending.next);
+
+    unlink(*timer);
+    mCount--;
+
+    if (timer->mMode == WheelTimer::Mode::PERIODIC) {
+      // keep to the original schedule rather than drifting with dispatch
+      const auto period = static_cast<uint64_t>(
+          std::max<TICK::rep>(timer->mDuration.count(), 1));
+
+      timer->mExpiry = std::max(timer->mExpiry + period, mCurrent + 1);
+      schedule(*timer);
+    } else {
+      timer->mIsRunning = false;
+    }
+
+    // the callback may destroy the timer, so it can not run from inside it
+    if (auto callback = timer->mCallback) {
+      callback();
+    }
+  }
+}
+
+void TimerWheel::append(Link &head, Link &node) noexcept {
+  node.prev = head.prev;
+  node.next = &head;
+  head.prev->next = &node;
+  head.prev = &node;
+}
+
+void TimerWheel::unlink(Link &node) noexcept {
+  node.prev->next = node.next;
+  node.next->prev = node.prev;
+  node.prev = nullptr;
+  node.next = nullptr;
+}
+
+int TimerWheel::nextOccupied(const BITMAP &occupied, unsigned from) noexcept {
+  // search [from, SLOTS) then wrap around to [0, from)
+  for (unsigned pass = 0; pass < 2; pass++) {
+    const auto begin = (pass == 0) ? from : 0;
+    const auto end = (pass == 0) ? SLOTS : from;
+
+    for (auto bit = begin; bit < end;) {
+      auto word = occupied[bit / WORD_BITS] >> (bit % WORD_BITS);
+
+      if (word != 0) {
+        const auto found = bit + static_cast<unsigned>(__builtin_ctzll(word));
+        return (found < end) ? static_cast<int>(found) : -1;
+      }
+
+      bit = (bit / WORD_BITS + 1) * WORD_BITS;
+    }
+  }
+
+  return -1;
+}
+
+WheelTimer::WheelTimer(Engine &engine) noexcept
+    : mWheel(&engine.mTimerWheel) {}
+
+WheelTimer::~WheelTimer() { stop(); }
+
+RETURN_CODE WheelTimer::start(const std::chrono::milliseconds &duration,
+                              Mode mode) noexcept {
+  if (duration.count() < 0) {
+    return RETURN::NOK;
+  }
+
+  mWheel->unschedule(*this);
+
+  mDuration = duration;
+  mMode = mode;
+  mExpiry = mWheel->expiryAfter(duration);
+  mWheel->schedule(*this);
+  mIsRunning = true;
+
+  return RETURN::OK;
+}
+
+RETURN_CODE WheelTimer::restart() noexcept {
+  if (mDuration == TimerWheel::TICK::max()) {
+    return RETURN::NOK;
+  }
+
+  return start(mDuration, mMode);
+}
+
+RETURN_CODE WheelTimer::stop() noexcept {
+  if (!mIsRunning) {
+    return RETURN::PASSABLE;
+  }
+
+  mWheel->unschedule(*this);
+  mIsRunning = false;
+
+  return RETURN::OK;
+}
+
+void WheelTimer::setCallback(std::function<void(void)> callback) {
+  mCallback = std::move(callback);
+}
+
+bool WheelTimer::isRunning() const noexcept { return mIsRunning; }
+
+} // namespace Context
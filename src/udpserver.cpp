@@ -1,6 +1,8 @@
 #include <sys/socket.h>
 #include <transport-cpp/networking/udpserver.h>
 
+#include <transport-cpp/engine.h>
+
 namespace Context::Devices::IO::Networking::UDP {
 Peer::Peer() : NetworkDevice() {}
 
@@ -21,10 +23,12 @@ void Peer::notifyNewData(const NetworkMessage &message) const noexcept {
 }
 
 Peer::~Peer() {
+  const auto notify_destruction = std::move(mNotifyDestruction);
+
   invalidate();
 
-  if (mNotifyDestruction) {
-    mNotifyDestruction(this);
+  if (notify_destruction) {
+    notify_destruction(this);
   }
 }
 
@@ -32,58 +36,62 @@ void Peer::setMessageHandler(const NETWORK_MSG_CALLBACK &handler) {
   mNewMessage = handler;
 }
 
-HostAddr Peer::getPeerAddress() const noexcept { return mPeerAddr; }
+HostAddr Peer::getPeerAddress() const { return mPeerEndpoint.toHostAddr(); }
+
+const Endpoint &Peer::getPeerEndpoint() const noexcept {
+  return mPeerEndpoint;
+}
 
 bool Peer::isValid() const noexcept { return mIsValid; }
 
 RETURN_CODE Peer::sendTo(const HostAddr &dest, const IODATA &message,
                          const IPVersion &ip_hint) {
-  if (mAsyncSendPlain) {
-    return mAsyncSendPlain(dest, message, ip_hint);
+  ResolvedAddr addr;
+
+  if (resolve(dest, addr, ip_hint) == RETURN::NOK) {
+    return RETURN::NOK;
   }
 
-  setError(ERROR_CODE::DEVICE_NOT_READY,
-           "This peer requires a valid server instance");
-  return RETURN::NOK;
+  return sendTo(addr, message);
 }
 
 RETURN_CODE Peer::sendTo(const HostAddr &dest,
                          const std::shared_ptr<IODATA> &message,
                          const IPVersion &ip_hint) {
-  if (mAsyncSendShared) {
-    return mAsyncSendShared(dest, message, ip_hint);
+  ResolvedAddr addr;
+
+  if (resolve(dest, addr, ip_hint) == RETURN::NOK) {
+    return RETURN::NOK;
   }
 
-  setError(ERROR_CODE::DEVICE_NOT_READY,
-           "This peer requires a valid server instance");
-  return RETURN::NOK;
+  return sendTo(addr, message);
 }
 
 RETURN_CODE Peer::sendTo(const HostAddr &dest, std::unique_ptr<IODATA> message,
                          const IPVersion &ip_hint) {
-  if (mAsyncSendUnique) {
-    return mAsyncSendUnique(dest, std::move(message), ip_hint);
+  ResolvedAddr addr;
+
+  if (resolve(dest, addr, ip_hint) == RETURN::NOK) {
+    return RETURN::NOK;
   }
 
-  setError(ERROR_CODE::DEVICE_NOT_READY,
-           "This peer requires a valid server instance");
-  return RETURN::NOK;
+  return sendTo(addr, std::move(message));
 }
 
 RETURN_CODE Peer::syncSendTo(const HostAddr &dest, const IODATA_CHOICE &message,
                              const IPVersion &ip_hint) {
-  if (mSyncSend) {
-    return mSyncSend(dest, message, ip_hint);
+  ResolvedAddr addr;
+
+  if (resolve(dest, addr, ip_hint) == RETURN::NOK) {
+    return RETURN::NOK;
   }
 
-  setError(ERROR_CODE::DEVICE_NOT_READY,
-           "This peer requires a valid server instance");
-  return RETURN::NOK;
+  return syncSendTo(addr, message);
 }
 
-RETURN_CODE Peer::asyncSend(const IODATA &data) {
+RETURN_CODE Peer::sendTo(const ResolvedAddr &dest, const IODATA &message) {
   if (mAsyncSendPlain) {
-    return mAsyncSendPlain(mPeerAddr, data, IPVersion::ANY);
+    return mAsyncSendPlain(dest, message);
   }
 
   setError(ERROR_CODE::DEVICE_NOT_READY,
@@ -91,9 +99,10 @@ RETURN_CODE Peer::asyncSend(const IODATA &data) {
   return RETURN::NOK;
 }
 
-RETURN_CODE Peer::asyncSend(const std::shared_ptr<IODATA> &data) {
+RETURN_CODE Peer::sendTo(const ResolvedAddr &dest,
+                         const std::shared_ptr<IODATA> &message) {
   if (mAsyncSendShared) {
-    return mAsyncSendShared(mPeerAddr, data, IPVersion::ANY);
+    return mAsyncSendShared(dest, message);
   }
 
   setError(ERROR_CODE::DEVICE_NOT_READY,
@@ -101,9 +110,10 @@ RETURN_CODE Peer::asyncSend(const std::shared_ptr<IODATA> &data) {
   return RETURN::NOK;
 }
 
-RETURN_CODE Peer::asyncSend(std::unique_ptr<IODATA> data) {
+RETURN_CODE Peer::sendTo(const ResolvedAddr &dest,
+                         std::unique_ptr<IODATA> message) {
   if (mAsyncSendUnique) {
-    return mAsyncSendUnique(mPeerAddr, std::move(data), IPVersion::ANY);
+    return mAsyncSendUnique(dest, std::move(message));
   }
 
   setError(ERROR_CODE::DEVICE_NOT_READY,
@@ -111,9 +121,10 @@ RETURN_CODE Peer::asyncSend(std::unique_ptr<IODATA> data) {
   return RETURN::NOK;
 }
 
-RETURN_CODE Peer::syncSend(const IODATA_CHOICE &data) {
+RETURN_CODE Peer::syncSendTo(const ResolvedAddr &dest,
+                             const IODATA_CHOICE &message) {
   if (mSyncSend) {
-    return mSyncSend(mPeerAddr, data, IPVersion::ANY);
+    return mSyncSend(dest, message);
   }
 
   setError(ERROR_CODE::DEVICE_NOT_READY,
@@ -121,7 +132,23 @@ RETURN_CODE Peer::syncSend(const IODATA_CHOICE &data) {
   return RETURN::NOK;
 }
 
-Server::Server() : NetworkDevice(), mLastPeer({}), mAddr({}) {}
+RETURN_CODE Peer::asyncSend(const IODATA &data) {
+  return sendTo(mResolvedPeerAddr, data);
+}
+
+RETURN_CODE Peer::asyncSend(const std::shared_ptr<IODATA> &data) {
+  return sendTo(mResolvedPeerAddr, data);
+}
+
+RETURN_CODE Peer::asyncSend(std::unique_ptr<IODATA> data) {
+  return sendTo(mResolvedPeerAddr, std::move(data));
+}
+
+RETURN_CODE Peer::syncSend(const IODATA_CHOICE &data) {
+  return syncSendTo(mResolvedPeerAddr, data);
+}
+
+Server::Server() : NetworkDevice(), mAddr({}) {}
 
 Server::~Server() { disconnect(); }
 
@@ -129,15 +156,42 @@ void Server::disconnect() noexcept {
   destroyHandle();
   mBound = false;
 
-  for (auto &peer : mPeers) {
-    peer->invalidate();
-  }
+  mPeers.forEach([](const Endpoint &, PeerEntry &entry) {
+    entry.peer->invalidate();
+  });
+
+  mPeers.clear();
 }
 
 void Server::setNewPeerHandler(const NEW_PEER_NOTIFY &handler) {
   mNewPeerNotify = handler;
 }
 
+void Server::setPeerExpiredHandler(const PEER_EXPIRED_NOTIFY &handler) {
+  mPeerExpiredNotify = handler;
+}
+
+void Server::setPeerLimits(const PeerLimits &limits) {
+  mPeerLimits = limits;
+
+  const auto now = CLOCK::now();
+
+  mPeers.forEach([this, now](const Endpoint &endpoint, PeerEntry &entry) {
+    entry.last_seen = now;
+    armIdleTimer(endpoint, entry);
+  });
+}
+
+Server::PeerLimits Server::getPeerLimits() const noexcept {
+  return mPeerLimits;
+}
+
+size_t Server::getPeerCount() const noexcept { return mPeers.size(); }
+
+uint64_t Server::getRejectedPeerCount() const noexcept {
+  return mRejectedPeers;
+}
+
 RETURN_CODE Server::bind(const HostAddr &host, const IPVersion &ip_hint) {
   disconnect();
 
@@ -179,7 +233,7 @@ RETURN_CODE Server::asyncSend(const IODATA &data) {
     return RETURN::NOK;
   }
 
-  return sendTo(mLastPeer, data, IPVersion::ANY);
+  return sendTo(ResolvedAddr(mLastPeer), data);
 }
 
 RETURN_CODE Server::asyncSend(const std::shared_ptr<IODATA> &data) {
@@ -190,7 +244,7 @@ RETURN_CODE Server::asyncSend(const std::shared_ptr<IODATA> &data) {
     return RETURN::NOK;
   }
 
-  return sendTo(mLastPeer, data, IPVersion::ANY);
+  return sendTo(ResolvedAddr(mLastPeer), data);
 }
 
 RETURN_CODE Server::asyncSend(std::unique_ptr<IODATA> data) {
@@ -201,7 +255,7 @@ RETURN_CODE Server::asyncSend(std::unique_ptr<IODATA> data) {
     return RETURN::NOK;
   }
 
-  return sendTo(mLastPeer, std::move(data), IPVersion::ANY);
+  return sendTo(ResolvedAddr(mLastPeer), std::move(data));
 }
 
 RETURN_CODE Server::syncSend(const IODATA_CHOICE &data) {
@@ -212,84 +266,166 @@ RETURN_CODE Server::syncSend(const IODATA_CHOICE &data) {
     return RETURN::NOK;
   }
 
-  return syncSendTo(mLastPeer, data, IPVersion::ANY);
+  return syncSendTo(ResolvedAddr(mLastPeer), data);
 }
 
 void Server::peerDestroyed(const Peer *peer) {
-  auto peer_it = std::find(mPeers.begin(), mPeers.end(), peer);
+  const auto entry = mPeers.find(peer->getPeerEndpoint());
+
+  if (entry != nullptr && entry->peer == peer) {
+    mPeers.erase(peer->getPeerEndpoint());
+  }
+}
+
+void Server::armIdleTimer(const Endpoint &endpoint, PeerEntry &entry) {
+  const auto engine = getCurrentLoadedEngine();
+
+  if (mPeerLimits.idle_timeout.count() <= 0 || engine == nullptr) {
+    entry.idle_timer.reset();
+    return;
+  }
+
+  if (!entry.idle_timer) {
+    entry.idle_timer = std::make_unique<WheelTimer>(*engine);
+    entry.idle_timer->setCallback(
+        [this, endpoint] { checkIdlePeer(endpoint); });
+  }
+
+  (void)entry.idle_timer->start(mPeerLimits.idle_timeout);
+}
+
+void Server::checkIdlePeer(const Endpoint &endpoint) {
+  const auto entry = mPeers.find(endpoint);
+
+  if (entry == nullptr) {
+    return;
+  }
+
+  // activity only stamps last_seen, the timer catches up with it here
+  const auto idle = CLOCK::now() - entry->last_seen;
+
+  if (idle < mPeerLimits.idle_timeout) {
+    (void)entry->idle_timer->start(
+        std::chrono::ceil<std::chrono::milliseconds>(
+            mPeerLimits.idle_timeout - idle));
+    return;
+  }
+
+  const auto peer = entry->peer;
+
+  // endpoint belongs to the timer's callback, which erasing destroys
+  const auto expired = endpoint;
+  mPeers.erase(expired);
+
+  peer->invalidate();
+
+  logDebug("UDPServer", "Peer expired");
 
-  if (peer_it != mPeers.end()) {
-    mPeers.erase(peer_it);
+  if (mPeerExpiredNotify) {
+    mPeerExpiredNotify(peer);
   }
 }
 
+void Server::engineChanged(Engine *engine) {
+  // wheel timers can not outlive the engine they run on
+  mPeers.forEach([this, engine](const Endpoint &endpoint, PeerEntry &entry) {
+    if (engine == nullptr) {
+      entry.idle_timer.reset();
+    } else {
+      armIdleTimer(endpoint, entry);
+    }
+  });
+}
+
 void Server::readyRead() {
-  NetworkMessage data;
+  if (hasIOBufferCallback()) {
+    NetworkDevice::readyRead();
+    return;
+  }
+
+  size_t count = 0;
 
-  auto read_resp = receiveMessage(data);
+  auto read_resp = receiveMessages(count);
 
   if (!std::holds_alternative<ERROR_CODE>(read_resp.code) ||
       std::get<ERROR_CODE>(read_resp.code) != ERROR_CODE::NO_ERROR) {
     logError("UDPServer/readyRead",
              "Error reading descriptor. " + read_resp.description);
+  }
+
+  if (count == 0) {
     return;
   }
 
-  notifyCallback(data);
+  notifyBatchCallback(mReceiveBatch.data(), count);
+
+  for (size_t x = 0; x < count; x++) {
+    routeMessage(mReceiveBatch[x]);
+  }
+}
 
-  auto relevant_peer =
-      std::find_if(mPeers.begin(), mPeers.end(), [&data](const Peer *pr) {
-        return pr->getPeerAddress().ip == data.peer.ip &&
-               pr->getPeerAddress().port == data.peer.port;
-      });
+void Server::routeMessage(const NetworkMessage &data) {
+  notifyCallback(data);
 
   mLastPeer = data.peer;
   mPeerConnected = true;
 
-  if (relevant_peer == mPeers.end()) {
+  if (const auto entry = mPeers.find(data.peer); entry != nullptr) {
+    if (mPeerLimits.idle_timeout.count() > 0) {
+      entry->last_seen = CLOCK::now();
+    }
 
-    logDebug("UDPServer", "New Peer connected");
+    entry->peer->notifyNewData(data);
+    return;
+  }
 
-    if (!mNewPeerNotify) {
-      return;
-    }
+  if (!mNewPeerNotify) {
+    return;
+  }
 
-    const auto new_peer_raw = new Peer();
-    auto new_peer = PEER(new_peer_raw);
+  if (mPeerLimits.max_peers > 0 && mPeers.size() >= mPeerLimits.max_peers) {
+    mRejectedPeers++;
+    return;
+  }
 
-    using namespace std::placeholders;
+  logDebug("UDPServer", "New Peer connected");
 
-    new_peer->mPeerAddr = data.peer;
-    new_peer->mIsValid = true;
+  const auto new_peer_raw = new Peer();
+  auto new_peer = PEER(new_peer_raw);
 
-    new_peer->mAsyncSendPlain =
-        [this](const HostAddr &dest, const IODATA &message,
-               const IPVersion &ip_hint) -> RETURN_CODE {
-      return sendTo(dest, message, ip_hint);
-    };
+  new_peer->mPeerEndpoint = data.peer;
+  new_peer->mResolvedPeerAddr = data.peer;
+  new_peer->mIsValid = true;
 
-    new_peer->mAsyncSendShared =
-        [this](const HostAddr &dest, const std::shared_ptr<IODATA> &message,
-               const IPVersion &ip_hint) -> RETURN_CODE {
-      return sendTo(dest, message, ip_hint);
-    };
+  new_peer->mAsyncSendPlain = [this](const ResolvedAddr &dest,
+                                     const IODATA &message) -> RETURN_CODE {
+    return sendTo(dest, message);
+  };
 
-    new_peer->mAsyncSendUnique =
-        [this](const HostAddr &dest, std::unique_ptr<IODATA> message,
-               const IPVersion &ip_hint) -> RETURN_CODE {
-      return sendTo(dest, std::move(message), ip_hint);
-    };
+  new_peer->mAsyncSendShared =
+      [this](const ResolvedAddr &dest,
+             const std::shared_ptr<IODATA> &message) -> RETURN_CODE {
+    return sendTo(dest, message);
+  };
 
-    new_peer->mSyncSend = [this](const HostAddr &dest,
-                                 const IODATA_CHOICE &message,
-                                 const IPVersion &ip_hint) -> RETURN_CODE {
-      return syncSendTo(dest, message, ip_hint);
-    };
+  new_peer->mAsyncSendUnique =
+      [this](const ResolvedAddr &dest,
+             std::unique_ptr<IODATA> message) -> RETURN_CODE {
+    return sendTo(dest, std::move(message));
+  };
 
-    mNewPeerNotify(data, std::move(new_peer));
-    mPeers.push_back(new_peer_raw);
-  } else {
-    (*relevant_peer)->notifyNewData(data);
-  }
+  new_peer->mSyncSend = [this](const ResolvedAddr &dest,
+                               const IODATA_CHOICE &message) -> RETURN_CODE {
+    return syncSendTo(dest, message);
+  };
+
+  new_peer->mNotifyDestruction = [this](Peer *peer) { peerDestroyed(peer); };
+
+  // in the table before the handler runs, it may drop the peer right away
+  auto &entry =
+      mPeers.insert(data.peer, {new_peer_raw, nullptr, CLOCK::now()});
+  armIdleTimer(data.peer, entry);
+
+  mNewPeerNotify(data, std::move(new_peer));
 }
 } // namespace Context::Devices::IO::Networking::UDP
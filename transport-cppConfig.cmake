@@ -1,3 +1,4 @@
 include(CMakeFindDependencyMacro)
 # find_dependency(xx 2.0)
+find_dependency(Threads)
 include(${CMAKE_CURRENT_LIST_DIR}/transport-cppTargets.cmake)